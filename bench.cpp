@@ -0,0 +1,263 @@
+/************************************************************************/
+/* bench.cpp - The .cpp file for on-device micro-benchmarks.            */
+/*                                                                      */
+/* Profiles the state handlers and next_state() while the robot runs,   */
+/* and times the compass, sensor and servo functions on command. The    */
+/* result is printed as JSON for comparison against a baseline.         */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "bench.h"
+#include "compass.h"
+#include "contact.h"
+#include "robot.h"
+#include "scan.h"
+#include "sensor.h"
+#include "servo.h"
+#include "state.h"
+#include "timer.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <util/atomic.h>
+
+/// Calls per timed run, and runs per benchmark (the fastest run is reported).
+#define BENCH_ITERATIONS  200
+#define BENCH_RUNS        5
+
+/// Arrays holding the profile of each slot (microseconds).
+static uint32_t bench_count[BENCH_SLOTS];
+static uint32_t bench_total[BENCH_SLOTS];
+static uint16_t bench_max[BENCH_SLOTS];
+
+/// Variable the benchmarked results are written to, so nothing is optimized away.
+static volatile int16_t bench_sink = 0;
+
+/// Variable holding the input of the benchmarks.
+static volatile uint8_t bench_input = 0;
+
+/// Variables holding the sonar reading counts and the time (ms) of the previous run.
+static uint16_t bench_readings[SONAR_COUNT] = {0, 0};
+static unsigned long bench_last_time = 0;
+
+/// End of the heap (avr-libc).
+extern char *__brkval;
+
+/// Pre-declaration of help functions.
+static void bench_one(const __FlashStringHelper *, void (*)(void), bool);
+static uint16_t bench_heap(void);
+static void bench_empty(void);
+static void bench_compass_heading_ok(void);
+static void bench_compass_convert(void);
+static void bench_sonar_hit(void);
+static void bench_sonar_within(void);
+static void bench_servo_step(void);
+static void bench_servo_at_angle(void);
+static void bench_scan_open_side(void);
+static void bench_contact_check(void);
+
+/************************************************************************/
+/* Adds one measurement (@param us) to a profiling slot (@param slot).  */
+/* Called from control_tick().                                          */
+/************************************************************************/
+void bench_profile(uint8_t slot, unsigned long us)
+{
+    if (slot >= BENCH_SLOTS) {
+        return;
+    }
+    
+    bench_count[slot]++;
+    bench_total[slot] += us;
+    
+    if (us > bench_max[slot]) {
+        bench_max[slot] = (uint16_t) us;
+    }
+}
+
+/************************************************************************/
+/* Runs the benchmarks and prints the results over serial as JSON.      */
+/* Servo stepping moves the top sensor servo - run with the robot idle. */
+/************************************************************************/
+void bench_run(void)
+{
+    Serial.println(F("{\"benchmarks\":["));
+    
+    bench_one(F("compass_heading_ok"), bench_compass_heading_ok, true);
+    bench_one(F("compass_convert"), bench_compass_convert, false);
+    bench_one(F("sonar_hit"), bench_sonar_hit, false);
+    bench_one(F("sonar_within"), bench_sonar_within, false);
+    bench_one(F("servo_angle_step"), bench_servo_step, false);
+    bench_one(F("servo_at_angle"), bench_servo_at_angle, false);
+    bench_one(F("scan_open_side"), bench_scan_open_side, false);
+    bench_one(F("contact_check"), bench_contact_check, false);
+    
+    Serial.println(F("],\"handlers\":["));
+    
+    for (uint8_t i = 0; i < BENCH_SLOTS; i++) {
+        uint32_t count;
+        uint32_t total;
+        uint16_t max;
+        
+        ATOMIC_BLOCK(ATOMIC_FORCEON) {
+            count = bench_count[i];
+            total = bench_total[i];
+            max   = bench_max[i];
+        }
+        
+        if (i != 0) {
+            Serial.println(',');
+        }
+        
+        Serial.print(F("{\"name\":\""));
+        
+        if (i == BENCH_NEXT_STATE) {
+            Serial.print(F("next_state"));
+        } else {
+            state_print_name(i - 1 + LIFTING_ARM_HOME);
+        }
+        
+        Serial.print(F("\",\"count\":"));
+        Serial.print(count);
+        Serial.print(F(",\"ns_per_op\":"));
+        Serial.print((count != 0) ? ((total * 1000) / count) : 0);
+        Serial.print(F(",\"max_ns\":"));
+        Serial.print((uint32_t) max * 1000);
+        
+        if (i != BENCH_NEXT_STATE) {
+            Serial.print(F(",\"overruns\":"));
+            Serial.print(state_overruns(i - 1 + LIFTING_ARM_HOME));
+        }
+        
+        Serial.print('}');
+    }
+    
+    Serial.print(F("\n],\"missed_ticks\":"));
+    Serial.print(timer_missed_ticks());
+    Serial.print(F(",\"watchdog_resets\":"));
+    Serial.print(timer_watchdog_resets());
+    
+    /// Sample rate of each sensor since the previous run (readings per second).
+    unsigned long now = millis();
+    unsigned long elapsed = now - bench_last_time;
+    
+    Serial.print(F(",\"sonar_hz\":["));
+    
+    for (uint8_t id = 0; id < SONAR_COUNT; id++) {
+        uint16_t readings = sonar_reading_count(id);
+        
+        if (id != 0) {
+            Serial.print(',');
+        }
+        
+        uint16_t count = readings - bench_readings[id];
+        
+        Serial.print((elapsed != 0) ? ((count * 1000.0) / elapsed) : 0.0, 1);
+        bench_readings[id] = readings;
+    }
+    
+    bench_last_time = now;
+    Serial.println(F("]}"));
+}
+
+/************************************************************************/
+/* Help function to time one benchmark (@param fn) and print it with    */
+/* its name (@param name). @param first says if it is the first one.    */
+/************************************************************************/
+static void bench_one(const __FlashStringHelper *name, void (*fn)(void), bool first)
+{
+    unsigned long best = ULONG_MAX;
+    unsigned long overhead = ULONG_MAX;
+    uint16_t heap = bench_heap();
+    
+    for (uint8_t run = 0; run < BENCH_RUNS; run++) {
+        /// Cost of the loop and the call itself.
+        unsigned long start = micros();
+        
+        for (uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+            bench_input = (uint8_t) i;
+            bench_empty();
+        }
+        
+        overhead = min(overhead, micros() - start);
+        
+        /// Cost including the benchmarked function.
+        start = micros();
+        
+        for (uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+            bench_input = (uint8_t) i;
+            fn();
+        }
+        
+        best = min(best, micros() - start);
+    }
+    
+    if (!first) {
+        Serial.println(',');
+    }
+    
+    Serial.print(F("{\"name\":\""));
+    Serial.print(name);
+    Serial.print(F("\",\"iterations\":"));
+    Serial.print(BENCH_ITERATIONS);
+    Serial.print(F(",\"ns_per_op\":"));
+    Serial.print((best > overhead) ? (((best - overhead) * 1000) / BENCH_ITERATIONS) : 0);
+    Serial.print(F(",\"heap_bytes\":"));
+    Serial.print(bench_heap() - heap);
+    Serial.print('}');
+}
+
+/************************************************************************/
+/* Help function that @returns the size of the heap in bytes.           */
+/************************************************************************/
+static uint16_t bench_heap(void)
+{
+    return (__brkval == 0) ? 0 : (uint16_t) (__brkval - __malloc_heap_start);
+}
+
+/************************************************************************/
+/* Benchmarked functions.                                               */
+/************************************************************************/
+static void bench_empty(void)
+{
+    bench_sink = bench_input;
+}
+
+static void bench_compass_heading_ok(void)
+{
+    bench_sink = compass_heading_ok();
+}
+
+static void bench_compass_convert(void)
+{
+    bench_sink = compass_convert(bench_input & 0x0F, bench_input);
+}
+
+static void bench_sonar_hit(void)
+{
+    bench_sink = sonar_hit(BUCKET_SONAR);
+}
+
+static void bench_sonar_within(void)
+{
+    bench_sink = sonar_within(TOP_SONAR, bench_input & 1);
+}
+
+static void bench_servo_step(void)
+{
+    servo_angle_increment(TOP_SENSOR, 1);
+    servo_angle_decrement(TOP_SENSOR, 1);
+}
+
+static void bench_servo_at_angle(void)
+{
+    bench_sink = servo_at_min_angle(bench_input % 5) || servo_at_max_angle(bench_input % 5);
+}
+
+static void bench_scan_open_side(void)
+{
+    bench_sink = scan_open_side();
+}
+
+static void bench_contact_check(void)
+{
+    bench_sink = contact_check(75, 10 + (bench_input & 0x1F));
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+/************************************************************************/
+/* bench.h - The .h file for on-device micro-benchmarks.                */
+/************************************************************************/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/// Profiling slots of the state machine.
+#define BENCH_NEXT_STATE  0
+#define BENCH_STATE(s)    (1 + (s) - LIFTING_ARM_HOME)
+#define BENCH_SLOTS       BENCH_STATE(COMPASS_CALIBRATION + 1)
+
+/************************************************************************/
+/* Declaration of functions used in bench.cpp (needed elsewhere).       */
+/************************************************************************/
+void bench_profile(uint8_t, unsigned long);
+void bench_run(void);
+
+#endif
\ No newline at end of file
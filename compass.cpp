@@ -6,35 +6,103 @@
 
 #include "Arduino.h"
 #include "compass.h"
+#include "config.h"
+#include "recorder.h"
 #include "robot.h"
+#include "timer.h"
+#include "wheel.h"
 #include <util/atomic.h>
 #include <Wire.h>
 
 /// A heading between the start heading plus/minus this value is considered OK.
 #define COMPASS_TRIGGER_ANGLE  4
 
+/// Measured turn rates are limited to this (degrees per second).
+#define COMPASS_MAX_RATE  720
+
+/// The heading is not extrapolated further than this from the latest sample (ms).
+#define COMPASS_MAX_PREDICTION  500
+
 /// 7-bit address, R/W bit controlled by Wire library.
 static const uint8_t compass_address = 0x42 >> 1;
 
 /// 8-bit address to the compass's RAM register.
 static const uint8_t address_to_ram = 0x74;
 
-/// Variable holding the start heading of the compass.
-static int16_t compass_start_heading = 0;
+/// Operational modes written to the RAM register. See datasheet.
+/// Standby Mode with periodic set/reset.
+#define COMPASS_STANDBY_MODE     0x10
+/// Continuous Mode, 20 Hz measurement rate, with periodic set/reset.
+#define COMPASS_CONTINUOUS_20HZ  0x72
+
+/// Memory of the compass for a run.
+typedef struct {
+    /// Start heading of the compass.
+    int16_t start_heading;
+    
+    /// Heading to turn to (the start heading unless set by compass_set_target()).
+    int16_t target_heading;
+    
+    /// Current heading of the compass (atomic).
+    int16_t heading_atomic;
+    
+    /// Heading estimator. The heading is extrapolated from the latest sample with
+    /// the turn rate (degrees per second) on every tick (see compass_tick()).
+    int16_t  sample_heading;
+    uint16_t sample_age;  // ticks
+    int8_t   sample_turn;
+    int16_t  rate;
+    int16_t  turn_rate;
+    int16_t  predicted;
+    
+    /// Calibration command ('C' or 'E') to be sent from the main loop.
+    volatile uint8_t command;
+    
+    /// Variable saying if the compass is in calibration mode.
+    volatile bool in_calibration;
+    
+    /// Variable saying if the compass is used. Without it the heading is dead
+    /// reckoned from the turn rate, so the turns are timed.
+    bool enabled;
+} compass_context_t;
+
+/// The compass of the robot.
+static RUN_LOCAL compass_context_t compass_context;
 
-/// Atomic variable holding the current heading of the compass.
-static int16_t compass_heading_atomic = 0;
+/// Pre-declaration of help functions.
+static void compass_sample(int16_t);
+static int16_t compass_difference(int16_t, int16_t);
+
+/************************************************************************/
+/* Clears the compass to the start of a run.                            */
+/************************************************************************/
+void compass_clear(void)
+{
+    memset(&compass_context, 0, sizeof(compass_context_t));
+    
+    compass_context.turn_rate = COMPASS_TURN_RATE;
+    compass_context.enabled = true;
+}
 
 /************************************************************************/
 /* Initialization of compass communication.                             */
 /************************************************************************/
 void compass_init(void)
 {
+    /// The compass held the bus before a watchdog reset - a second try would only
+    /// reset the robot again.
+    if (timer_watchdog_resets() != 0) {
+        compass_context.enabled = false;
+        
+        Serial.println(F("Compass skipped, timed turns"));
+        return;
+    }
+    
     /// Start I2C communication.
     Wire.begin();
   
     /// Write setup to compass.
-    compass_write_to_ram(0x10);
+    compass_write_to_ram(COMPASS_CONTINUOUS_MODE ? COMPASS_CONTINUOUS_20HZ : COMPASS_STANDBY_MODE);
   
     /// Safety delay.
     delay(1000);
@@ -55,53 +123,104 @@ void compass_init(void)
     compass_update(GET_HEADING);
   
     /// Assign updated value to start heading variable.
-    compass_start_heading = compass_heading_atomic;  
+    compass_context.start_heading = compass_context.heading_atomic;  
+    compass_context.target_heading = compass_context.start_heading;
   
     Serial.print("CS: ");
-    Serial.println(compass_heading_atomic);
+    Serial.println(compass_context.heading_atomic);
 }
 
 /************************************************************************/
 /* Calculates or retrieves new heading (@param task).                   */
+/* In Continuous Mode the heading is retrieved for both tasks.          */
 /************************************************************************/
 void compass_update(uint8_t task)
 {
-    /// Assumes Standby Mode. Performs new heading calculation.
-    if (task) {
+    /// No compass - nothing to send or retrieve.
+    if (!compass_context.enabled) {
+        compass_context.command = 0;
+        return;
+    }
+    
+    /// A pending calibration command is sent instead of the heading task.
+    if (compass_context.command) {
+        timer_watchdog_arm();
+        Wire.beginTransmission(compass_address);
+        Wire.write(compass_context.command);  // Enter ('C') or exit ('E') calibration mode
+        Wire.endTransmission();
+        timer_watchdog_disarm();
+        
+        /// Records the command, the host replay sends it at the same tick.
+        recorder_log(RECORD_COMPASS_COMMAND, 0, compass_context.command);
+        
+        compass_context.in_calibration = (compass_context.command == 'C') ? true : false;
+        compass_context.command = 0;
+        return;
+    }
+    
+    /// No headings are available in calibration mode.
+    if (compass_context.in_calibration) {
+        return;
+    }
+    
+    /// Standby Mode. Performs new heading calculation.
+    if (task && !COMPASS_CONTINUOUS_MODE) {
+        timer_watchdog_arm();
         Wire.beginTransmission(compass_address);
         Wire.write('A');  // Get heading
         Wire.endTransmission();
+        timer_watchdog_disarm();
 
     /// Get heading.
     } else {
-        /// Request to read two byte of data.
+        /// Request to read two byte of data. A hung bus resets the robot.
+        timer_watchdog_arm();
         Wire.requestFrom(compass_address, (uint8_t) 2);  // Casting due to compiler warning
+        timer_watchdog_disarm();
     
         /// Read and store data (value between 0-3599).
         uint8_t MSB = Wire.read();
         uint8_t LSB = Wire.read();
 
         /// Calculates the heading.
-        float heading = 0.1 * (( MSB << 8 ) + LSB);
-
-        /// Possible conversion to negative value.
-        if(heading > 180) heading -= 360;
+        int16_t heading = compass_convert(MSB, LSB);
     
+        /// Records changes of the heading.
+        if (RECORD_ALL_INPUTS || (heading != compass_context.heading_atomic)) {
+            recorder_log(RECORD_COMPASS, 0, heading);
+        }
+        
         /// Stores the heading in an atomic variable.
         ATOMIC_BLOCK(ATOMIC_FORCEON) {
-            compass_heading_atomic = (int16_t) heading;
+            compass_context.heading_atomic = heading;
+            
+            compass_sample(heading);
         }
-    
-        Serial.print("C: ");
-        Serial.println(compass_heading_atomic);        
     }
 }
 
+/************************************************************************/
+/* @returns the heading (-180 to 180) of raw compass data (@param MSB   */
+/* and @param LSB, value between 0-3599).                               */
+/************************************************************************/
+int16_t compass_convert(uint8_t MSB, uint8_t LSB)
+{
+    /// Calculates the heading.
+    float heading = 0.1 * (( MSB << 8 ) + LSB);
+
+    /// Possible conversion to negative value.
+    if(heading > 180) heading -= 360;
+    
+    return (int16_t) heading;
+}
+
 /************************************************************************/
 /* Write desired setup (@param data) to the RAM register. See datasheet.*/
 /************************************************************************/
 void compass_write_to_ram(uint8_t data)
 {
+  timer_watchdog_arm();
+  
   /// Perform write to RAM request.
   Wire.beginTransmission(compass_address);
   Wire.write('G');  // Write to RAM register
@@ -118,6 +237,8 @@ void compass_write_to_ram(uint8_t data)
   /// Finish write to RAM operation.
   Wire.write(data);
   Wire.endTransmission();
+  
+  timer_watchdog_disarm();
 }
 
 /************************************************************************/
@@ -125,6 +246,8 @@ void compass_write_to_ram(uint8_t data)
 /************************************************************************/
 uint8_t compass_read_from_ram(void)
 {
+    timer_watchdog_arm();
+    
     /// Perform read from RAM request.
     Wire.beginTransmission(compass_address);
     Wire.write('g');  // Read from RAM register
@@ -135,21 +258,236 @@ uint8_t compass_read_from_ram(void)
     /// Continue with read from RAM operation.
     Wire.write(address_to_ram);
     Wire.endTransmission();
+    
+    timer_watchdog_disarm();
 
     /// Safety delay.
     delay(1000);
   
     /// Request to read one byte of data.
+    timer_watchdog_arm();
     Wire.requestFrom(compass_address, (uint8_t) 1);  // Casting due to compiler warning
+    timer_watchdog_disarm();
   
     return (uint8_t) Wire.read();
 }
 
+/************************************************************************/
+/* Requests the compass to enter (@param enter = true) or exit user     */
+/* calibration mode. The command is sent by compass_update().           */
+/************************************************************************/
+void compass_calibration(bool enter)
+{
+    compass_context.command = enter ? 'C' : 'E';
+}
+
+/************************************************************************/
+/* @returns whether the compass is used or not.                         */
+/************************************************************************/
+bool compass_available(void)
+{
+    return compass_context.enabled;
+}
+
+/************************************************************************/
+/* @returns whether the compass is in (or about to enter) calibration   */
+/* mode or not.                                                         */
+/************************************************************************/
+bool compass_calibrating(void)
+{
+    return (compass_context.in_calibration || (compass_context.command == 'C')) ? true : false;
+}
+
+/************************************************************************/
+/* @returns the current heading of the compass (-180 to 180).           */
+/************************************************************************/
+int16_t compass_heading(void)
+{
+    int16_t heading;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        heading = compass_context.heading_atomic;
+    }
+    
+    return heading;
+}
+
+/************************************************************************/
+/* Advances the heading estimate by one tick.                           */
+/* Called from control_tick().                                          */
+/************************************************************************/
+void compass_tick(void)
+{
+    int8_t turn = wheel_turn_direction();
+    
+    /// No compass samples - the prediction so far is the next starting point, when
+    /// the turn changes or the prediction limit is reached.
+    if (!compass_context.enabled && ((turn != compass_context.sample_turn) || (compass_context.sample_age >= MS_TO_TICKS(COMPASS_MAX_PREDICTION)))) {
+        compass_context.sample_heading = compass_context.predicted;
+        compass_context.sample_age     = 0;
+        compass_context.sample_turn    = turn;
+    }
+    
+    if (compass_context.sample_age < MS_TO_TICKS(COMPASS_MAX_PREDICTION)) {
+        compass_context.sample_age++;
+    }
+    
+    /// Not turning.
+    if (turn == 0) {
+        compass_context.rate = 0;
+        
+    /// A new turn - use the rate of the latest turn until it is measured.
+    } else if ((compass_context.rate == 0) || ((compass_context.rate > 0) != (turn > 0))) {
+        compass_context.rate = turn * compass_context.turn_rate;
+    }
+    
+    compass_context.predicted = compass_difference(compass_context.sample_heading + 
+        (int16_t) (((int32_t) compass_context.rate * (int32_t) TICKS_TO_MS(compass_context.sample_age)) / 1000), 0);
+}
+
+/************************************************************************/
+/* @returns the predicted heading of the compass (-180 to 180).         */
+/************************************************************************/
+int16_t compass_heading_predicted(void)
+{
+    int16_t heading;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        heading = compass_context.predicted;
+    }
+    
+    return heading;
+}
+
+/************************************************************************/
+/* @returns whether the predicted heading is within the trigger angle   */
+/* of a given heading (@param heading) or not.                          */
+/************************************************************************/
+bool compass_heading_near(int16_t heading)
+{
+    return (abs(compass_difference(compass_heading_predicted(), heading)) <= COMPASS_TRIGGER_ANGLE) ? true : false;
+}
+
+/************************************************************************/
+/* @returns the predicted heading relative to the start heading         */
+/* (-180 to 180, clockwise > 0).                                        */
+/************************************************************************/
+int16_t compass_offset(void)
+{
+    return compass_difference(compass_heading_predicted(), compass_context.start_heading);
+}
+
+/************************************************************************/
+/* Takes the start heading again, e.g. after a calibration. The         */
+/* predicted heading is @param offset from the new start heading. The   */
+/* target heading keeps its offset from the start heading.              */
+/************************************************************************/
+void compass_set_start(int16_t offset)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        int16_t target = compass_difference(compass_context.target_heading, compass_context.start_heading);
+        
+        compass_context.start_heading  = compass_difference(compass_context.predicted, offset);
+        compass_context.target_heading = compass_difference(compass_context.start_heading + target, 0);
+    }
+    
+    Serial.print("CS: ");
+    Serial.println(compass_context.start_heading);
+}
+
+/************************************************************************/
+/* Sets the heading to turn to, relative to the start heading           */
+/* (@param offset, clockwise > 0).                                      */
+/************************************************************************/
+void compass_set_target(int16_t offset)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        compass_context.target_heading = compass_difference(compass_context.start_heading + offset, 0);
+    }
+}
+
+/************************************************************************/
+/* @returns the shortest turn to the target heading: 1 for clockwise    */
+/* (right) and -1 for counterclockwise (left).                          */
+/************************************************************************/
+int8_t compass_target_turn(void)
+{
+    int16_t error;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        error = compass_difference(compass_context.target_heading, compass_context.predicted);
+    }
+    
+    return (error >= 0) ? 1 : -1;
+}
+
 /************************************************************************/
 /* @returns whether the heading is OK or not, when turning to mid wall. */
+/* The turn is stopped ahead of the target heading, so it ends there.   */
 /************************************************************************/
 bool compass_heading_ok(void)
 {
-    return ((compass_heading_atomic >= (compass_start_heading - COMPASS_TRIGGER_ANGLE)) && 
-        (compass_heading_atomic <= (compass_start_heading + COMPASS_TRIGGER_ANGLE))) ? true : false;
+    int16_t error;
+    int16_t lead;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        error = compass_difference(compass_context.target_heading, compass_context.predicted);
+        lead  = (int16_t) (((int32_t) compass_context.rate * COMPASS_STOP_LEAD) / 1000);
+    }
+    
+    /// Within the trigger angle.
+    if (abs(error) <= COMPASS_TRIGGER_ANGLE) {
+        return true;
+    }
+    
+    /// Turning towards the target heading and reaching it within the stop lead.
+    return (((lead > 0) && (error > 0) && (error <= lead)) || 
+        ((lead < 0) && (error < 0) && (error >= lead))) ? true : false;
+}
+
+/************************************************************************/
+/* Help function to store a new heading sample (@param heading) in the  */
+/* heading estimator. Must be called with interrupts disabled.          */
+/************************************************************************/
+static void compass_sample(int16_t heading)
+{
+    int8_t turn = wheel_turn_direction();
+    
+    /// The whole interval since the previous sample was part of this turn.
+    if ((turn != 0) && (turn == compass_context.sample_turn) && 
+        (compass_context.sample_age > 0) && (compass_context.sample_age < MS_TO_TICKS(COMPASS_MAX_PREDICTION))) {
+        int32_t measured = ((int32_t) compass_difference(heading, compass_context.sample_heading) * 1000) / 
+            (int32_t) TICKS_TO_MS(compass_context.sample_age);
+        int16_t rate = (int16_t) constrain(measured, (int32_t) -COMPASS_MAX_RATE, (int32_t) COMPASS_MAX_RATE);
+        
+        /// Ignores samples against the turn (e.g. magnetic disturbances).
+        if ((rate != 0) && ((rate > 0) == (turn > 0))) {
+            compass_context.rate = rate;
+            compass_context.turn_rate = abs(rate);
+        }
+    }
+    
+    compass_context.sample_heading = heading;
+    compass_context.sample_age     = 0;
+    compass_context.sample_turn    = turn;
+    compass_context.predicted      = heading;
+}
+
+/************************************************************************/
+/* Help function that @returns the difference between two headings      */
+/* (@param a minus @param b) in the range -180 to 180.                  */
+/************************************************************************/
+static int16_t compass_difference(int16_t a, int16_t b)
+{
+    int16_t difference = a - b;
+    
+    while (difference > 180) {
+        difference -= 360;
+    }
+    
+    while (difference < -180) {
+        difference += 360;
+    }
+    
+    return difference;
 }
\ No newline at end of file
@@ -11,9 +11,22 @@
 /* Declaration of functions used in compass.cpp (needed elsewhere).     */
 /************************************************************************/
 void compass_init(void);
+void compass_clear(void);
 void compass_update(uint8_t);
+int16_t compass_convert(uint8_t, uint8_t);
 void compass_write_to_ram(uint8_t);
 uint8_t compass_read_from_ram(void);
+void compass_calibration(bool);
+bool compass_available(void);
+bool compass_calibrating(void);
+int16_t compass_heading(void);
+void compass_tick(void);
+int16_t compass_heading_predicted(void);
+bool compass_heading_near(int16_t);
+int16_t compass_offset(void);
+void compass_set_start(int16_t);
+void compass_set_target(int16_t);
+int8_t compass_target_turn(void);
 bool compass_heading_ok(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+/************************************************************************/
+/* config.cpp - The .cpp file for the tunable parameters.               */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "config.h"
+
+/// Prints one parameter (@param name) as a #define line.
+#define CONFIG_PRINT(name)                      \
+    do {                                        \
+        Serial.print(F("#define " #name "  ")); \
+        Serial.println(name);                   \
+    } while (0)
+
+/// Prints one float parameter (@param name) as a #define line. Serial.println()
+/// rounds floats to 2 decimals, which would lose a tuned 0.005.
+#define CONFIG_PRINT_FLOAT(name)                \
+    do {                                        \
+        Serial.print(F("#define " #name "  ")); \
+        Serial.println(name, 6);                \
+    } while (0)
+
+/************************************************************************/
+/* Prints the parameter set over serial, in the format of tuning.h.     */
+/************************************************************************/
+void config_print(void)
+{
+    CONFIG_PRINT(TICK_PERIOD_MS);
+    
+    CONFIG_PRINT(LIFTING_ARM_DELAY_TIME);
+    CONFIG_PRINT(GO_BACK_DELAY_TIME);
+    CONFIG_PRINT(MAKE_TURN_DELAY_TIME);
+    CONFIG_PRINT(COMPASS_TIME_OUT);
+    CONFIG_PRINT(TURN_TO_MID_WALL_DELAY);
+    CONFIG_PRINT(COMPASS_CALIBRATE_AT_BOOT);
+    CONFIG_PRINT(COMPASS_CALIBRATION_TIME);
+    CONFIG_PRINT(BACK_AWAY_TRIG_COUNT);
+    CONFIG_PRINT(STATE_BUDGET_SERVO_TIME);
+    CONFIG_PRINT(STATE_BUDGET_MARGIN);
+    
+    CONFIG_PRINT(MAGAZINE_CAPACITY);
+    CONFIG_PRINT(MAGAZINE_LAUNCH_COUNT);
+    CONFIG_PRINT(MAGAZINE_HOLD_TIME);
+    CONFIG_PRINT(MAGAZINE_LAUNCH_WHEN_ALIGNED);
+    
+    CONFIG_PRINT(NAV_START_DISTANCE);
+    CONFIG_PRINT(NAV_SPEED_HIGH);
+    CONFIG_PRINT(NAV_SPEED_LOW);
+    CONFIG_PRINT(NAV_LAUNCH_DISTANCE);
+    CONFIG_PRINT(NAV_MAX_BEARING);
+    CONFIG_PRINT(NAV_SIGHTING_TOLERANCE);
+    CONFIG_PRINT(NAV_TURN_CLEARANCE);
+    
+    CONFIG_PRINT(CRUISE_SPEED_MIN);
+    CONFIG_PRINT(CRUISE_SPEED_MAX);
+    CONFIG_PRINT(CRUISE_SPEED_STEP);
+    CONFIG_PRINT(CRUISE_NEAR_DISTANCE);
+    CONFIG_PRINT(CRUISE_FREE_DISTANCE);
+    CONFIG_PRINT(PICKUP_SPEED);
+    
+    CONFIG_PRINT(GRID_CELL_SIZE);
+    CONFIG_PRINT(GRID_SIDE_DISTANCE);
+    
+    CONFIG_PRINT(CONTACT_REACTION_TIME);
+    CONFIG_PRINT(CONTACT_DECELERATION);
+    CONFIG_PRINT(CONTACT_MARGIN_MID);
+    CONFIG_PRINT(CONTACT_MARGIN_SIDE);
+    
+    CONFIG_PRINT(COMPASS_CONTINUOUS_MODE);
+    CONFIG_PRINT(COMPASS_TURN_RATE);
+    CONFIG_PRINT(COMPASS_STOP_LEAD);
+    
+    CONFIG_PRINT(BUCKET_SENSOR_TRIGGER_DISTANCE);
+    CONFIG_PRINT(TOP_SENSOR_TRIGGER_DISTANCE_MID);
+    CONFIG_PRINT(TOP_SENSOR_TRIGGER_DISTANCE_SIDE);
+    CONFIG_PRINT(BUCKET_SENSOR_RANGE);
+    CONFIG_PRINT(TOP_SENSOR_RANGE);
+    
+    CONFIG_PRINT_FLOAT(DETECTOR_HIT_RATE_BALL);
+    CONFIG_PRINT_FLOAT(DETECTOR_HIT_RATE_EMPTY);
+    CONFIG_PRINT_FLOAT(DETECTOR_FALSE_POSITIVE);
+    CONFIG_PRINT_FLOAT(DETECTOR_MISS_RATE);
+    CONFIG_PRINT(DETECTOR_MAX_SAMPLES);
+    
+    CONFIG_PRINT(SWEEP_WIDE_PERIOD);
+    CONFIG_PRINT(SWEEP_NARROW_PERIOD);
+    CONFIG_PRINT(SWEEP_NEAR_DISTANCE);
+    CONFIG_PRINT(SWEEP_CLEAR_DISTANCE);
+    
+    CONFIG_PRINT(WHEEL_SPEED_RIGHT_HIGH);
+    CONFIG_PRINT(WHEEL_SPEED_LEFT_HIGH);
+    CONFIG_PRINT(WHEEL_SPEED_RIGHT_LOW);
+    CONFIG_PRINT(WHEEL_SPEED_LEFT_LOW);
+    CONFIG_PRINT(WHEEL_TRIM_PERIOD);
+    CONFIG_PRINT(WHEEL_TRIM_DEADBAND);
+    CONFIG_PRINT(WHEEL_TRIM_MAX);
+    
+    CONFIG_PRINT(KPI_BASELINE_FIRST_LAUNCH);
+    CONFIG_PRINT(KPI_BASELINE_LAUNCH_RATE);
+    CONFIG_PRINT(KPI_BASELINE_WALL_TURN_RATE);
+    CONFIG_PRINT(KPI_BASELINE_COMPASS_TIMEOUTS);
+    CONFIG_PRINT(KPI_BASELINE_BUDGET_OVERRUNS);
+}
\ No newline at end of file
@@ -0,0 +1,406 @@
+/************************************************************************/
+/* config.h - The tunable parameters of the robot project.              */
+/*                                                                      */
+/* Every parameter can be overridden by a tuning.h file placed next to  */
+/* this file, e.g. the output of a parameter tuner or of the 'p' serial */
+/* command.                                                             */
+/************************************************************************/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#if defined(__has_include)
+#if __has_include("tuning.h")
+#include "tuning.h"
+#endif
+#endif
+
+/************************************************************************/
+/* Timing parameters (timer.cpp).                                       */
+/************************************************************************/
+/// Period of the state machine tick (ms, 1-262).
+/// All other times are given in ms and rounded up to whole ticks.
+#ifndef TICK_PERIOD_MS
+#define TICK_PERIOD_MS  10
+#endif
+
+/************************************************************************/
+/* State parameters (state.cpp).                                        */
+/************************************************************************/
+/// Delay until the lifting arm moves down (ms).
+#ifndef LIFTING_ARM_DELAY_TIME
+#define LIFTING_ARM_DELAY_TIME  1000
+#endif
+
+/// Delay time for the robot to go back before it makes a turn (ms).
+#ifndef GO_BACK_DELAY_TIME
+#define GO_BACK_DELAY_TIME  750
+#endif
+
+/// Delay time for the robot to make a turn (ms).
+#ifndef MAKE_TURN_DELAY_TIME
+#define MAKE_TURN_DELAY_TIME  1250
+#endif
+
+/// Time before a compass heading search is considered timed out (ms).
+#ifndef COMPASS_TIME_OUT
+#define COMPASS_TIME_OUT  10000
+#endif
+
+/// Time to delay next compass heading search (ms).
+/// This delay might be delayed itself if the robot picks up a ball or has to turn for wall.
+#ifndef TURN_TO_MID_WALL_DELAY
+#define TURN_TO_MID_WALL_DELAY  6000
+#endif
+
+/// Calibrate the compass (state 12) after the startup states (1) or not (0).
+/// A calibration can also be requested with the 'c' serial command.
+#ifndef COMPASS_CALIBRATE_AT_BOOT
+#define COMPASS_CALIBRATE_AT_BOOT  0
+#endif
+
+/// Time to spin in place with the compass in calibration mode (ms).
+/// At Low Speed Mode this should cover at least one full turn.
+#ifndef COMPASS_CALIBRATION_TIME
+#define COMPASS_CALIBRATION_TIME  15000
+#endif
+
+/// Maximum value of bucket trigger signals before the robot desides to turn for wall.
+#ifndef BACK_AWAY_TRIG_COUNT
+#define BACK_AWAY_TRIG_COUNT  3
+#endif
+
+/// Longest time a servo state may take before it is abandoned (ms).
+/// The slowest servo move (the catapult arm, 120 steps of 1 degree) takes about 1.2 seconds.
+#ifndef STATE_BUDGET_SERVO_TIME
+#define STATE_BUDGET_SERVO_TIME  5000
+#endif
+
+/// Time added to the own delays and time outs of the other states for their budget (ms).
+#ifndef STATE_BUDGET_MARGIN
+#define STATE_BUDGET_MARGIN  2000
+#endif
+
+/************************************************************************/
+/* Magazine parameters (magazine.cpp, state.cpp).                       */
+/************************************************************************/
+/// Number of balls the robot can hold (one in the catapult, the rest in the bucket).
+#ifndef MAGAZINE_CAPACITY
+#define MAGAZINE_CAPACITY  2
+#endif
+
+/// The bucket holds one ball, a second one would be dumped on it by the next pickup.
+#if MAGAZINE_CAPACITY > 2
+#error "MAGAZINE_CAPACITY can be at most 2 (one ball in the catapult, one in the bucket)"
+#endif
+
+/// Number of balls to hold before going to the mid wall.
+#ifndef MAGAZINE_LAUNCH_COUNT
+#define MAGAZINE_LAUNCH_COUNT  1
+#endif
+
+/// Time (ms) after which fewer balls are launched anyway. 0 waits for MAGAZINE_LAUNCH_COUNT.
+#ifndef MAGAZINE_HOLD_TIME
+#define MAGAZINE_HOLD_TIME  30000
+#endif
+
+/// Launch as soon as the robot faces the mid wall (1) or drive up to it first (0).
+#ifndef MAGAZINE_LAUNCH_WHEN_ALIGNED
+#define MAGAZINE_LAUNCH_WHEN_ALIGNED  0
+#endif
+
+/************************************************************************/
+/* Navigation parameters (nav.cpp, state.cpp).                          */
+/************************************************************************/
+/// Distance from the start position to the mid wall along the start heading (cm).
+#ifndef NAV_START_DISTANCE
+#define NAV_START_DISTANCE  100
+#endif
+
+/// Driving speed in High- and Low Speed Mode (cm/s).
+#ifndef NAV_SPEED_HIGH
+#define NAV_SPEED_HIGH  30
+#endif
+
+#ifndef NAV_SPEED_LOW
+#define NAV_SPEED_LOW  20
+#endif
+
+/// Distance in front of the mid wall to drive towards and launch from (cm).
+#ifndef NAV_LAUNCH_DISTANCE
+#define NAV_LAUNCH_DISTANCE  40
+#endif
+
+/// Maximum angle from the start heading to drive towards the mid wall (degrees).
+#ifndef NAV_MAX_BEARING
+#define NAV_MAX_BEARING  30
+#endif
+
+/// Sightings this far from the expected mid wall are ignored (cm).
+#ifndef NAV_SIGHTING_TOLERANCE
+#define NAV_SIGHTING_TOLERANCE  40
+#endif
+
+/// Free distance ahead needed to turn to mid wall without moving backwards (cm).
+#ifndef NAV_TURN_CLEARANCE
+#define NAV_TURN_CLEARANCE  30
+#endif
+
+/************************************************************************/
+/* Cruise speed parameters (state.cpp).                                 */
+/************************************************************************/
+/// Driving speed in the default state with an obstacle near and with free space (cm/s).
+/// The speed is scaled linearly with the nearest distance seen by the top sensor.
+/// The wheels are calibrated up to NAV_SPEED_HIGH only.
+#ifndef CRUISE_SPEED_MIN
+#define CRUISE_SPEED_MIN  20
+#endif
+
+#ifndef CRUISE_SPEED_MAX
+#define CRUISE_SPEED_MAX  NAV_SPEED_HIGH
+#endif
+
+#if CRUISE_SPEED_MAX > NAV_SPEED_HIGH
+#error "CRUISE_SPEED_MAX must not be above NAV_SPEED_HIGH"
+#endif
+
+/// Steps of the driving speed (cm/s), so small changes of the nearest distance
+/// don't fill the flight recorder with speed changes.
+#ifndef CRUISE_SPEED_STEP
+#define CRUISE_SPEED_STEP  5
+#endif
+
+/// Nearest distance for the minimum and the maximum speed (cm).
+#ifndef CRUISE_NEAR_DISTANCE
+#define CRUISE_NEAR_DISTANCE  20
+#endif
+
+#ifndef CRUISE_FREE_DISTANCE
+#define CRUISE_FREE_DISTANCE  45
+#endif
+
+/// Driving speed while a ball is loaded (cm/s). The robot holds until the catch is
+/// confirmed, then creeps with the top sensor looking ahead while the arm and bucket
+/// move, and stops for a predicted wall contact. 0 stops the robot for the whole pickup.
+#ifndef PICKUP_SPEED
+#define PICKUP_SPEED  NAV_SPEED_LOW
+#endif
+
+/************************************************************************/
+/* Occupancy grid parameters (grid.cpp, state.cpp).                     */
+/************************************************************************/
+/// Size of a grid cell (cm). The 64 x 64 grid covers 64 cells along each axis.
+#ifndef GRID_CELL_SIZE
+#define GRID_CELL_SIZE  5
+#endif
+
+/// Distance to the sides checked for remembered walls when the sweep can't
+/// choose the side of a turn for wall (cm).
+#ifndef GRID_SIDE_DISTANCE
+#define GRID_SIDE_DISTANCE  100
+#endif
+
+/************************************************************************/
+/* Collision prediction parameters (contact.cpp).                       */
+/************************************************************************/
+/// Time from a top sensor reading until the brakes act (ms).
+/// Covers the sweep settle, the ping and the next control tick.
+#ifndef CONTACT_REACTION_TIME
+#define CONTACT_REACTION_TIME  200
+#endif
+
+/// Deceleration of the robot when braking (cm/s^2).
+#ifndef CONTACT_DECELERATION
+#define CONTACT_DECELERATION  150
+#endif
+
+/// Distance left to a wall after stopping, straight ahead and to the sides (cm).
+/// At the top speed (NAV_SPEED_HIGH, 30 cm/s) the wall avoidance triggers at 17/19 cm,
+/// close to TOP_SENSOR_TRIGGER_DISTANCE_MID/SIDE.
+#ifndef CONTACT_MARGIN_MID
+#define CONTACT_MARGIN_MID  8
+#endif
+
+#ifndef CONTACT_MARGIN_SIDE
+#define CONTACT_MARGIN_SIDE  10
+#endif
+
+/************************************************************************/
+/* Compass parameters (compass.cpp).                                    */
+/************************************************************************/
+/// Run the compass in Continuous Mode at 20 Hz (1), one read per heading, or in
+/// Standby Mode (0), a heading request and a read per heading at 10 Hz with less power.
+#ifndef COMPASS_CONTINUOUS_MODE
+#define COMPASS_CONTINUOUS_MODE  1
+#endif
+
+/// Turn rate in place at Low Speed Mode (degrees per second).
+/// Used until the rate of the current turn has been measured.
+#ifndef COMPASS_TURN_RATE
+#define COMPASS_TURN_RATE  90
+#endif
+
+/// Time the robot keeps turning after the stop command (ms).
+/// The turn to mid wall is stopped this much ahead of the predicted heading.
+#ifndef COMPASS_STOP_LEAD
+#define COMPASS_STOP_LEAD  50
+#endif
+
+/************************************************************************/
+/* Sensor parameters (sensor.cpp).                                      */
+/************************************************************************/
+/// Distances for the system to get triggered (cm).
+#ifndef BUCKET_SENSOR_TRIGGER_DISTANCE
+#define BUCKET_SENSOR_TRIGGER_DISTANCE  15
+#endif
+
+#ifndef TOP_SENSOR_TRIGGER_DISTANCE_MID
+#define TOP_SENSOR_TRIGGER_DISTANCE_MID  16
+#endif
+
+#ifndef TOP_SENSOR_TRIGGER_DISTANCE_SIDE
+#define TOP_SENSOR_TRIGGER_DISTANCE_SIDE  18
+#endif
+
+/// Ranges the sensors ping in the states using them (cm). The echo timeout is set to match.
+/// The bucket sensor only needs its trigger distance. The top sensor feeds the scan map
+/// (cruise speed, sweep and navigation), up to its built-in maximum of 50 cm.
+#ifndef BUCKET_SENSOR_RANGE
+#define BUCKET_SENSOR_RANGE  (BUCKET_SENSOR_TRIGGER_DISTANCE + 2)
+#endif
+
+#ifndef TOP_SENSOR_RANGE
+#define TOP_SENSOR_RANGE  50
+#endif
+
+/************************************************************************/
+/* Ball detector parameters (detector.cpp).                             */
+/************************************************************************/
+/// Probability of a bucket sensor hit when there is a ball in front of the robot.
+#ifndef DETECTOR_HIT_RATE_BALL
+#define DETECTOR_HIT_RATE_BALL  0.80
+#endif
+
+/// Probability of a bucket sensor hit when there is no ball (false echoes).
+#ifndef DETECTOR_HIT_RATE_EMPTY
+#define DETECTOR_HIT_RATE_EMPTY  0.05
+#endif
+
+/// Target probability of deciding on a ball when there is none (empty bucket swings).
+#ifndef DETECTOR_FALSE_POSITIVE
+#define DETECTOR_FALSE_POSITIVE  0.01
+#endif
+
+/// Target probability of missing a ball that is there.
+#ifndef DETECTOR_MISS_RATE
+#define DETECTOR_MISS_RATE  0.05
+#endif
+
+/// Latency target: maximum number of samples (50 ms each) in one test. A test that hasn't
+/// reached the ball threshold by then decides on no ball and starts over.
+#ifndef DETECTOR_MAX_SAMPLES
+#define DETECTOR_MAX_SAMPLES  6
+#endif
+
+/************************************************************************/
+/* Top sensor sweep parameters (sweep.cpp).                             */
+/************************************************************************/
+/// Time between top sensor pings (ms).
+#ifndef SWEEP_WIDE_PERIOD
+#define SWEEP_WIDE_PERIOD  200
+#endif
+
+#ifndef SWEEP_NARROW_PERIOD
+#define SWEEP_NARROW_PERIOD  100
+#endif
+
+/// Obstacles closer than this narrow the sweep (cm).
+#ifndef SWEEP_NEAR_DISTANCE
+#define SWEEP_NEAR_DISTANCE  30
+#endif
+
+/// Sectors free beyond this distance are considered clear (cm).
+#ifndef SWEEP_CLEAR_DISTANCE
+#define SWEEP_CLEAR_DISTANCE  40
+#endif
+
+/************************************************************************/
+/* Wheel parameters (wheel.cpp).                                        */
+/************************************************************************/
+/// Wheel speed in High Speed Mode.
+#ifndef WHEEL_SPEED_RIGHT_HIGH
+#define WHEEL_SPEED_RIGHT_HIGH  120
+#endif
+
+#ifndef WHEEL_SPEED_LEFT_HIGH
+#define WHEEL_SPEED_LEFT_HIGH  120
+#endif
+
+/// Wheel speed in Low Speed Mode.
+#ifndef WHEEL_SPEED_RIGHT_LOW
+#define WHEEL_SPEED_RIGHT_LOW  100
+#endif
+
+#ifndef WHEEL_SPEED_LEFT_LOW
+#define WHEEL_SPEED_LEFT_LOW  100
+#endif
+
+/// Other target speeds are interpolated between the Low- and High Speed Mode
+/// values, which give NAV_SPEED_LOW and NAV_SPEED_HIGH.
+
+/// Time of driving straight forward between trim updates (ms).
+#ifndef WHEEL_TRIM_PERIOD
+#define WHEEL_TRIM_PERIOD  500
+#endif
+
+/// Heading drift per trim update that is taken as driving straight (degrees).
+#ifndef WHEEL_TRIM_DEADBAND
+#define WHEEL_TRIM_DEADBAND  2
+#endif
+
+/// Maximum trim (PWM steps).
+#ifndef WHEEL_TRIM_MAX
+#define WHEEL_TRIM_MAX  20
+#endif
+
+/************************************************************************/
+/* KPI baselines (kpi.cpp).                                             */
+/************************************************************************/
+/// Latest first launch after the startup states (ms).
+#ifndef KPI_BASELINE_FIRST_LAUNCH
+#define KPI_BASELINE_FIRST_LAUNCH  60000
+#endif
+
+/// Fewest launches per minute (tenths).
+#ifndef KPI_BASELINE_LAUNCH_RATE
+#define KPI_BASELINE_LAUNCH_RATE  10
+#endif
+
+/// Most turns for wall per minute (tenths).
+#ifndef KPI_BASELINE_WALL_TURN_RATE
+#define KPI_BASELINE_WALL_TURN_RATE  60
+#endif
+
+/// Most compass heading searches timing out and states running out of their time budget.
+#ifndef KPI_BASELINE_COMPASS_TIMEOUTS
+#define KPI_BASELINE_COMPASS_TIMEOUTS  1
+#endif
+
+#ifndef KPI_BASELINE_BUDGET_OVERRUNS
+#define KPI_BASELINE_BUDGET_OVERRUNS  0
+#endif
+
+/************************************************************************/
+/* Tuner parameters (host/tuner.cpp).                                   */
+/************************************************************************/
+/// The tuner build of the host varies some of the parameters above from run to run.
+#ifdef TUNER
+#include "tuner.h"
+#endif
+
+/************************************************************************/
+/* Declaration of functions used in config.cpp (needed elsewhere).      */
+/************************************************************************/
+void config_print(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+/************************************************************************/
+/* contact.cpp - The .cpp file for the collision prediction.            */
+/*                                                                      */
+/* Estimates the closing speed towards the obstacle seen by the top     */
+/* sensor, from successive readings and the commanded speed, and        */
+/* predicts a collision when the distance is within the stopping        */
+/* distance at that speed.                                              */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "contact.h"
+#include "config.h"
+#include "nav.h"
+#include "robot.h"
+#include "scan.h"
+
+/// Servo angle of the top sensor looking straight ahead.
+#define CONTACT_SENSOR_MID_ANGLE  75
+
+/// Sensor directions within this angle of straight ahead use the mid margin (degrees).
+#define CONTACT_MID_BEARING  15
+
+/// Readings closer than this are considered noise (same limit as the top sensor in sensor.cpp).
+#define CONTACT_MIN_DISTANCE  10
+
+/// Previous readings older than this are not used to measure the closing speed (ms).
+#define CONTACT_MAX_AGE  1000
+
+/// Memory of the collision prediction for a run.
+typedef struct {
+    /// Variable saying if a collision has been predicted (consumed by contact_predicted()).
+    bool pending;
+} contact_context_t;
+
+/// The collision prediction of the robot.
+static RUN_LOCAL contact_context_t contact_context;
+
+/************************************************************************/
+/* Clears the collision prediction to the start of a run.               */
+/************************************************************************/
+void contact_clear(void)
+{
+    memset(&contact_context, 0, sizeof(contact_context_t));
+}
+
+/************************************************************************/
+/* Checks a top sensor reading (@param distance) at servo angle         */
+/* (@param angle). Must be called before scan_update() stores it.       */
+/************************************************************************/
+void contact_update(int16_t angle, uint8_t distance)
+{
+    if (contact_check(angle, distance)) {
+        contact_context.pending = true;
+    }
+}
+
+/************************************************************************/
+/* @returns whether a top sensor reading (@param distance) at servo     */
+/* angle (@param angle) is within the stopping distance or not. Nothing */
+/* is stored.                                                           */
+/************************************************************************/
+bool contact_check(int16_t angle, uint8_t distance)
+{
+    /// No echo or noise.
+    if (distance < CONTACT_MIN_DISTANCE) {
+        return false;
+    }
+    
+    int16_t bearing = angle - CONTACT_SENSOR_MID_ANGLE;
+    
+    /// Commanded speed towards the obstacle.
+    float closing = nav_speed() * cos(radians(bearing));
+    
+    /// Measured speed towards the obstacle, from the previous reading at the same position.
+    uint8_t previous = scan_distance(angle);
+    uint16_t age = scan_age(angle);
+    
+    if ((previous != SCAN_UNKNOWN) && (age > 0) && (age < CONTACT_MAX_AGE)) {
+        float measured = (previous - distance) * 1000.0 / age;
+        
+        if (measured > closing) {
+            closing = measured;
+        }
+    }
+    
+    /// Distance needed to stop from the closing speed, plus a margin at standstill.
+    /// Same as a time to contact (distance / closing) shorter than the time to stop.
+    float stopping = (abs(bearing) <= CONTACT_MID_BEARING) ? CONTACT_MARGIN_MID : CONTACT_MARGIN_SIDE;
+    
+    if (closing > 0) {
+        stopping += closing * (CONTACT_REACTION_TIME / 1000.0) + 
+            (closing * closing) / (2.0 * CONTACT_DECELERATION);
+    }
+    
+    return (distance <= stopping) ? true : false;
+}
+
+/************************************************************************/
+/* @returns whether a collision has been predicted since the last call. */
+/************************************************************************/
+bool contact_predicted(void)
+{
+    bool predicted = contact_context.pending;
+    
+    contact_context.pending = false;
+    
+    return predicted;
+}
\ No newline at end of file
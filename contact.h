@@ -0,0 +1,16 @@
+/************************************************************************/
+/* contact.h - The .h file for the collision prediction.                */
+/************************************************************************/
+
+#ifndef CONTACT_H
+#define CONTACT_H
+
+/************************************************************************/
+/* Declaration of functions used in contact.cpp (needed elsewhere).     */
+/************************************************************************/
+void contact_clear(void);
+void contact_update(int16_t, uint8_t);
+bool contact_check(int16_t, uint8_t);
+bool contact_predicted(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+/************************************************************************/
+/* detector.cpp - The .cpp file for the statistical ball detector.      */
+/*                                                                      */
+/* Runs a sequential probability ratio test (SPRT) on the bucket sensor */
+/* samples and decides as soon as the evidence for a ball is enough.    */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "detector.h"
+#include "config.h"
+#include "robot.h"
+#include <util/atomic.h>
+
+/// Fixed-point scale of the log-likelihood ratio.
+#define DETECTOR_SCALE  16
+
+/// Memory of the ball detector for a run.
+typedef struct {
+    /// Log-likelihood ratio steps and decision thresholds (fixed-point).
+    int16_t hit_step;
+    int16_t miss_step;
+    int16_t ball_level;
+    int16_t none_level;
+    
+    /// Accumulated log-likelihood ratio (fixed-point).
+    volatile int16_t llr;
+    
+    /// Number of samples since the test was restarted.
+    volatile uint8_t samples;
+    
+    /// Variable saying if the test has decided on a ball.
+    volatile bool decided;
+} detector_context_t;
+
+/// The ball detector of the robot.
+static RUN_LOCAL detector_context_t detector_context;
+
+/************************************************************************/
+/* Clears the ball detector to the start of a run.                      */
+/************************************************************************/
+void detector_clear(void)
+{
+    memset(&detector_context, 0, sizeof(detector_context_t));
+}
+
+/************************************************************************/
+/* Initialization of the ball detector.                                 */
+/************************************************************************/
+void detector_init(void)
+{
+    /// Log-likelihood ratio of one hit and one miss.
+    detector_context.hit_step  = (int16_t) lround(DETECTOR_SCALE * log(DETECTOR_HIT_RATE_BALL / DETECTOR_HIT_RATE_EMPTY));
+    detector_context.miss_step = (int16_t) lround(DETECTOR_SCALE * log((1 - DETECTOR_HIT_RATE_BALL) / (1 - DETECTOR_HIT_RATE_EMPTY)));
+    
+    /// Wald's thresholds for the false positive and miss rate targets.
+    detector_context.ball_level = (int16_t) lround(DETECTOR_SCALE * log((1 - DETECTOR_MISS_RATE) / DETECTOR_FALSE_POSITIVE));
+    detector_context.none_level = (int16_t) lround(DETECTOR_SCALE * log(DETECTOR_MISS_RATE / (1 - DETECTOR_FALSE_POSITIVE)));
+    
+    detector_reset();
+}
+
+/************************************************************************/
+/* Adds one bucket sensor sample (@param hit) to the test.              */
+/************************************************************************/
+void detector_update(bool hit)
+{
+    ATOMIC_BLOCK(ATOMIC_FORCEON) {
+        /// Waiting for the decision to be used.
+        if (detector_context.decided) {
+            return;
+        }
+        
+        detector_context.llr += hit ? detector_context.hit_step : detector_context.miss_step;
+        detector_context.samples++;
+        
+        /// Enough evidence for a ball.
+        if (detector_context.llr >= detector_context.ball_level) {
+            detector_context.decided = true;
+            
+        /// Enough evidence for no ball - restart the test.
+        } else if (detector_context.llr <= detector_context.none_level) {
+            detector_context.llr = 0;
+            detector_context.samples = 0;
+            
+        /// Latency target reached without enough evidence for a ball - restart the test,
+        /// so the false positive target still holds.
+        } else if (detector_context.samples == DETECTOR_MAX_SAMPLES) {
+            detector_context.llr = 0;
+            detector_context.samples = 0;
+        }
+    }
+}
+
+/************************************************************************/
+/* Restarts the test.                                                   */
+/************************************************************************/
+void detector_reset(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        detector_context.llr = 0;
+        detector_context.samples = 0;
+        detector_context.decided = false;
+    }
+}
+
+/************************************************************************/
+/* @returns whether there is a ball to pick up or not.                  */
+/************************************************************************/
+bool detector_ball(void)
+{
+    return detector_context.decided;
+}
+
+/************************************************************************/
+/* @returns whether there is any evidence of a ball or not.             */
+/************************************************************************/
+bool detector_evidence(void)
+{
+    return (detector_context.llr > 0) ? true : false;
+}
+
+/************************************************************************/
+/* @returns the confidence (0-100 %) that there is a ball.              */
+/************************************************************************/
+uint8_t detector_confidence(void)
+{
+    int16_t llr = detector_context.llr;
+    
+    if (llr <= 0) {
+        return 0;
+    } else if (llr >= detector_context.ball_level) {
+        return 100;
+    }
+    
+    return (uint8_t) (((int32_t) llr * 100) / detector_context.ball_level);
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+/************************************************************************/
+/* detector.h - The .h file for the statistical ball detector.          */
+/************************************************************************/
+
+#ifndef DETECTOR_H
+#define DETECTOR_H
+
+/************************************************************************/
+/* Declaration of functions used in detector.cpp (needed elsewhere).    */
+/************************************************************************/
+void detector_init(void);
+void detector_clear(void);
+void detector_update(bool);
+void detector_reset(void);
+bool detector_ball(void);
+bool detector_evidence(void);
+uint8_t detector_confidence(void);
+
+#endif
\ No newline at end of file
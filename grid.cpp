@@ -0,0 +1,278 @@
+/************************************************************************/
+/* grid.cpp - The .cpp file for the occupancy grid of the arena.        */
+/*                                                                      */
+/* Remembers what the top sensor has seen, in cells of GRID_CELL_SIZE   */
+/* with 2 bits each, placed by the position estimate (nav.cpp), the     */
+/* compass heading and the sweep angle. The grid uses the axes of       */
+/* nav.cpp and covers the own half of the arena in front of the mid     */
+/* wall. Bearings are relative to the heading of the robot, clockwise   */
+/* (right) > 0.                                                         */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "grid.h"
+#include "compass.h"
+#include "config.h"
+#include "nav.h"
+#include "robot.h"
+#include "sensor.h"
+
+/// Number of cells along each axis (1 KB of SRAM at 2 bits per cell).
+#define GRID_SIZE  64
+
+/// Position of the grid corner (cm). The mid wall (x = 0) is inside the last columns.
+#define GRID_X_MIN  (-(GRID_SIZE - 4) * GRID_CELL_SIZE)
+#define GRID_Y_MIN  (-(GRID_SIZE / 2) * GRID_CELL_SIZE)
+
+/// Cell states. A hit raises an occupied cell, a pass with an echo beyond it lowers it.
+/// Queries treat both wall states as obstacles.
+#define GRID_UNKNOWN   0
+#define GRID_FREE      1
+#define GRID_WALL_MAY  2
+#define GRID_WALL      3
+
+/// Servo angle of the top sensor looking straight ahead.
+#define GRID_SENSOR_MID_ANGLE  75
+
+/// Readings closer than this are considered noise (same limit as the top sensor in sensor.cpp).
+#define GRID_MIN_DISTANCE  10
+
+/// Directions searched for unexplored cells (degrees between them) and how far (cm).
+#define GRID_SEARCH_STEP      30
+#define GRID_SEARCH_DISTANCE  150
+
+/// Memory of the occupancy grid for a run.
+typedef struct {
+    /// Cells, four to a byte.
+    uint8_t cells[(GRID_SIZE * GRID_SIZE) / 4];
+} grid_context_t;
+
+/// The occupancy grid of the robot.
+static RUN_LOCAL grid_context_t grid_context;
+
+/// Pre-declaration of help functions.
+static bool grid_cell(float, float, uint16_t *);
+static uint8_t grid_get(uint16_t);
+static void grid_set(uint16_t, uint8_t);
+static float grid_direction(int16_t);
+
+/************************************************************************/
+/* Clears the occupancy grid to the start of a run (all unknown).       */
+/************************************************************************/
+void grid_clear(void)
+{
+    memset(&grid_context, 0, sizeof(grid_context_t));
+}
+
+/************************************************************************/
+/* Adds a top sensor reading (@param distance, 0 for no echo) at servo  */
+/* angle (@param angle). Takes at most one step per cell in range.      */
+/************************************************************************/
+void grid_update(int16_t angle, uint8_t distance)
+{
+    /// Noise.
+    if ((distance != 0) && (distance < GRID_MIN_DISTANCE)) {
+        return;
+    }
+    
+    /// No echo - free as far as the sensor reaches.
+    bool hit = (distance != 0) ? true : false;
+    uint8_t reach = hit ? distance : sonar_range(TOP_SONAR);
+    
+    float x0;
+    float y0;
+    nav_position(&x0, &y0);
+    
+    /// Sensor angles grow to the left, bearings to the right.
+    float direction = grid_direction(GRID_SENSOR_MID_ANGLE - angle);
+    float dx = cos(direction);
+    float dy = sin(direction);
+    
+    uint16_t index;
+    
+    /// The cells passed by the beam are free. A missing echo may be a specular miss,
+    /// so it doesn't lower a wall.
+    for (uint16_t travelled = 0; (travelled + GRID_CELL_SIZE) <= reach; travelled += GRID_CELL_SIZE) {
+        if (grid_cell(x0 + dx * travelled, y0 + dy * travelled, &index)) {
+            uint8_t cell = grid_get(index);
+            
+            if (cell < GRID_WALL_MAY) {
+                grid_set(index, GRID_FREE);
+            } else if (hit) {
+                grid_set(index, cell - 1);
+            }
+        }
+    }
+    
+    /// The cell of the echo is occupied.
+    if (hit && grid_cell(x0 + dx * reach, y0 + dy * reach, &index)) {
+        grid_set(index, (grid_get(index) >= GRID_WALL_MAY) ? GRID_WALL : GRID_WALL_MAY);
+    }
+}
+
+/************************************************************************/
+/* @returns the distance (cm) to the first remembered wall at           */
+/* @param bearing, or @param max_distance if there is none that close.  */
+/* Unknown cells are not walls, maybe walls are.                        */
+/************************************************************************/
+uint8_t grid_clearance(int16_t bearing, uint8_t max_distance)
+{
+    float x;
+    float y;
+    nav_position(&x, &y);
+    
+    float direction = grid_direction(bearing);
+    float dx = cos(direction) * GRID_CELL_SIZE;
+    float dy = sin(direction) * GRID_CELL_SIZE;
+    
+    uint16_t index;
+    
+    for (uint16_t travelled = 0; travelled < max_distance; travelled += GRID_CELL_SIZE) {
+        if (grid_cell(x, y, &index) && (grid_get(index) >= GRID_WALL_MAY)) {
+            return (uint8_t) travelled;
+        }
+        
+        x += dx;
+        y += dy;
+    }
+    
+    return max_distance;
+}
+
+/************************************************************************/
+/* @returns whether no wall is remembered within @param distance (cm)   */
+/* at @param bearing or not.                                            */
+/************************************************************************/
+bool grid_path_free(int16_t bearing, uint8_t distance)
+{
+    return (grid_clearance(bearing, distance) >= distance) ? true : false;
+}
+
+/************************************************************************/
+/* @returns the bearing of the nearest unknown cell that can be reached */
+/* without passing a wall, or GRID_NO_BEARING.                          */
+/************************************************************************/
+int16_t grid_unexplored_bearing(void)
+{
+    int16_t nearest_bearing = GRID_NO_BEARING;
+    uint16_t nearest = UINT16_MAX;
+    
+    float x0;
+    float y0;
+    nav_position(&x0, &y0);
+    
+    for (int16_t bearing = -180 + GRID_SEARCH_STEP; bearing <= 180; bearing += GRID_SEARCH_STEP) {
+        float direction = grid_direction(bearing);
+        float dx = cos(direction) * GRID_CELL_SIZE;
+        float dy = sin(direction) * GRID_CELL_SIZE;
+        float x = x0;
+        float y = y0;
+        
+        for (uint16_t travelled = 0; (travelled < GRID_SEARCH_DISTANCE) && (travelled < nearest); travelled += GRID_CELL_SIZE) {
+            uint16_t index;
+            
+            /// Outside the arena.
+            if (!grid_cell(x, y, &index)) {
+                break;
+            }
+            
+            uint8_t cell = grid_get(index);
+            
+            if (cell >= GRID_WALL_MAY) {
+                break;
+            }
+            
+            if (cell == GRID_UNKNOWN) {
+                nearest = travelled;
+                nearest_bearing = bearing;
+                break;
+            }
+            
+            x += dx;
+            y += dy;
+        }
+    }
+    
+    return nearest_bearing;
+}
+
+/************************************************************************/
+/* Prints the grid over serial, one row per x (mid wall last).          */
+/* '#' wall, '+' maybe wall, '.' free, ' ' unknown, 'R' the robot.      */
+/************************************************************************/
+void grid_print(void)
+{
+    float x;
+    float y;
+    nav_position(&x, &y);
+    
+    uint16_t robot = UINT16_MAX;
+    grid_cell(x, y, &robot);
+    
+    for (uint8_t row = 0; row < GRID_SIZE; row++) {
+        for (uint8_t column = 0; column < GRID_SIZE; column++) {
+            uint16_t index = (uint16_t) row * GRID_SIZE + column;
+            
+            if (index == robot) {
+                Serial.print('R');
+                continue;
+            }
+            
+            switch (grid_get(index)) {
+                case GRID_WALL :     Serial.print('#'); break;
+                case GRID_WALL_MAY : Serial.print('+'); break;
+                case GRID_FREE :     Serial.print('.'); break;
+                default :            Serial.print(' '); break;
+            }
+        }
+        
+        Serial.println();
+    }
+}
+
+/************************************************************************/
+/* Help function to find the cell of a position (@param x and @param y, */
+/* cm) and store its index in @param index. @returns false outside the  */
+/* grid.                                                                */
+/************************************************************************/
+static bool grid_cell(float x, float y, uint16_t *index)
+{
+    int16_t row    = (int16_t) floor((x - GRID_X_MIN) / GRID_CELL_SIZE);
+    int16_t column = (int16_t) floor((y - GRID_Y_MIN) / GRID_CELL_SIZE);
+    
+    if ((row < 0) || (row >= GRID_SIZE) || (column < 0) || (column >= GRID_SIZE)) {
+        return false;
+    }
+    
+    *index = (uint16_t) row * GRID_SIZE + column;
+    
+    return true;
+}
+
+/************************************************************************/
+/* Help function that @returns the state of a cell (@param index).      */
+/************************************************************************/
+static uint8_t grid_get(uint16_t index)
+{
+    return (grid_context.cells[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+/************************************************************************/
+/* Help function to set the state (@param state) of a cell              */
+/* (@param index).                                                      */
+/************************************************************************/
+static void grid_set(uint16_t index, uint8_t state)
+{
+    uint8_t shift = (index & 3) * 2;
+    
+    grid_context.cells[index >> 2] = (grid_context.cells[index >> 2] & ~(3 << shift)) | (state << shift);
+}
+
+/************************************************************************/
+/* Help function that @returns the direction in the grid (radians) of a */
+/* bearing from the robot (@param bearing, degrees, clockwise > 0).     */
+/************************************************************************/
+static float grid_direction(int16_t bearing)
+{
+    return radians(compass_offset() + bearing);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+/************************************************************************/
+/* grid.h - The .h file for the occupancy grid of the arena.            */
+/************************************************************************/
+
+#ifndef GRID_H
+#define GRID_H
+
+/// Value reported when no direction is found.
+#define GRID_NO_BEARING  INT16_MAX
+
+/************************************************************************/
+/* Declaration of functions used in grid.cpp (needed elsewhere).        */
+/************************************************************************/
+void grid_clear(void);
+void grid_update(int16_t, uint8_t);
+uint8_t grid_clearance(int16_t, uint8_t);
+bool grid_path_free(int16_t, uint8_t);
+int16_t grid_unexplored_bearing(void);
+void grid_print(void);
+
+#endif
\ No newline at end of file
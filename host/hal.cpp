@@ -0,0 +1,746 @@
+/************************************************************************/
+/* hal.cpp - The .cpp file for the simulated hardware of the host build.*/
+/*                                                                      */
+/* Time only moves when the firmware waits (delay(), pings, the I2C     */
+/* bus, a full serial buffer) or when the driver advances it, so a run  */
+/* is repeatable and as fast as the host allows. Calls cost a little    */
+/* time while the costs are on, so busy loops make progress.            */
+/************************************************************************/
+
+#include <stdio.h>
+#include <string>
+#include "host.h"
+#include "Arduino.h"
+#include "NewPing.h"
+#include "Wire.h"
+#include "avr/wdt.h"
+#include "util/atomic.h"
+
+/// Number of pins of the Arduino Mega.
+#define HOST_PINS  70
+
+/// Time some calls take while the costs are on (us).
+#define HOST_CALL_COST      1    // millis(), micros() and atomic blocks
+#define HOST_PING_COST      450  // trigger pulse and the wait for the burst
+#define HOST_WIRE_COST      300  // one I2C transaction at 100 kHz
+
+/// Round trip time of sound per cm of distance (us).
+#define HOST_US_ROUNDTRIP_CM  57
+
+/// Size of the serial transmit buffer (bytes) and the bits sent per byte.
+#define HOST_SERIAL_BUFFER  64
+#define HOST_SERIAL_BITS    10
+
+/// Length of one Timer4 count with the 64 prescaler (us).
+#define HOST_TIMER4_US_PER_COUNT  4
+
+/// HMC6352 compass: address and the RAM address of the operational mode.
+#define HOST_COMPASS_ADDRESS   0x21
+#define HOST_COMPASS_RAM_MODE  0x74
+
+/// Simulated hardware of one robot.
+typedef struct {
+    /// Virtual time (us) and if calls cost time.
+    uint64_t time;
+    bool costs;
+
+    /// Interrupts enabled, a Timer4 match while they were disabled, and the time of
+    /// the next match when the timer runs.
+    bool interrupts;
+    bool tick_flag;
+    bool timer_running;
+    uint64_t tick_time;
+
+    /// Digital outputs and PWM duty cycles.
+    uint8_t pin[HOST_PINS];
+    int16_t pwm[HOST_PINS];
+
+    /// Serial port: baud rate, time the transmit buffer is empty, output, echo of the
+    /// output to stdout and input.
+    unsigned long baud;
+    uint64_t serial_done;
+    std::string serial_out;
+    bool serial_echo;
+    std::string serial_in;
+
+    /// Inputs.
+    host_ping_t ping;
+    host_heading_t heading;
+
+    /// I2C bus: bytes of the transmission and of the request.
+    uint8_t wire_tx[4];
+    uint8_t wire_tx_length;
+    uint8_t wire_rx[2];
+    uint8_t wire_rx_length;
+    uint8_t wire_rx_index;
+
+    /// HMC6352 compass: operational mode, RAM address to read, and the heading
+    /// measured by the latest 'A' command (standby mode).
+    uint8_t compass_mode;
+    uint8_t compass_ram_address;
+    bool compass_measured;
+    uint16_t compass_measurement;
+} host_hw_t;
+
+/// Hardware of the robot on this thread.
+static thread_local host_hw_t host;
+
+/// Registers.
+thread_local volatile uint8_t MCUSR;
+thread_local volatile uint8_t TIMSK4;
+thread_local volatile uint8_t TCCR3A, TCCR3B, TCCR4A, TCCR4B, TCCR5A, TCCR5B;
+thread_local volatile uint16_t ICR3, ICR5;
+thread_local volatile uint16_t OCR3A, OCR3B, OCR4A, OCR5A, OCR5B, OCR5C;
+
+/// Heap bounds, the host build has no heap of its own.
+char *__brkval = 0;
+char *__malloc_heap_start = 0;
+
+/// The serial port and the I2C bus.
+HardwareSerial Serial;
+TwoWire Wire;
+
+/// Interrupt Service Routine of Timer4 (timer.cpp).
+extern "C" void TIMER4_COMPB_vect(void);
+
+/// Pre-declaration of help functions.
+static void host_cost(uint32_t);
+static void host_timer_check(void);
+static void host_interrupt(void);
+static void host_serial_put(uint8_t);
+
+/************************************************************************/
+/* Starts fresh hardware for a robot on this thread, with the inputs    */
+/* (@param ping and @param heading, 0 for none).                        */
+/************************************************************************/
+void host_begin(host_ping_t ping, host_heading_t heading)
+{
+    host = host_hw_t();
+    host.costs = true;
+    host.interrupts = true;
+    host.ping = ping;
+    host.heading = heading;
+
+    MCUSR = (1 << PORF);
+    TIMSK4 = 0;
+    TCCR3A = TCCR3B = TCCR4A = TCCR4B = TCCR5A = TCCR5B = 0;
+    ICR3 = ICR5 = 0;
+    OCR3A = OCR3B = OCR4A = OCR5A = OCR5B = OCR5C = 0;
+}
+
+/************************************************************************/
+/* Turns the time the calls take on or off (@param costs). With the     */
+/* costs off only the driver and waits move the time.                   */
+/************************************************************************/
+void host_costs(bool costs)
+{
+    host.costs = costs;
+}
+
+/************************************************************************/
+/* Advances the time (@param us), serving the Timer4 matches on the way.*/
+/************************************************************************/
+void host_advance(uint32_t us)
+{
+    uint64_t target = host.time + us;
+
+    host_timer_check();
+
+    while (host.timer_running && (host.tick_time <= target)) {
+        host.time = host.tick_time;
+        host.tick_time += (OCR4A + 1UL) * HOST_TIMER4_US_PER_COUNT;
+
+        host_interrupt();
+    }
+
+    host.time = target;
+}
+
+/************************************************************************/
+/* Advances the time to the next Timer4 match, if the timer runs.       */
+/************************************************************************/
+void host_next_tick(void)
+{
+    host_timer_check();
+
+    if (host.timer_running) {
+        host_advance((uint32_t) (host.tick_time - host.time));
+    }
+}
+
+/************************************************************************/
+/* @returns the time (us).                                              */
+/************************************************************************/
+uint64_t host_time(void)
+{
+    return host.time;
+}
+
+/************************************************************************/
+/* @returns the level of a digital output (@param pin).                 */
+/************************************************************************/
+uint8_t host_pin(uint8_t pin)
+{
+    return (pin < HOST_PINS) ? host.pin[pin] : LOW;
+}
+
+/************************************************************************/
+/* @returns the PWM duty cycle (0-255) of an output (@param pin).       */
+/************************************************************************/
+int16_t host_pwm(uint8_t pin)
+{
+    return (pin < HOST_PINS) ? host.pwm[pin] : 0;
+}
+
+/************************************************************************/
+/* Turns the echo of the serial output to stdout on or off (@param echo)*/
+/************************************************************************/
+void host_serial_echo(bool echo)
+{
+    host.serial_echo = echo;
+}
+
+/************************************************************************/
+/* Queues serial input (@param input) for the firmware.                 */
+/************************************************************************/
+void host_serial_send(const char *input)
+{
+    host.serial_in += input;
+}
+
+/************************************************************************/
+/* @returns the serial output since the previous call.                  */
+/************************************************************************/
+std::string host_serial_take(void)
+{
+    std::string output;
+
+    output.swap(host.serial_out);
+
+    return output;
+}
+
+/************************************************************************/
+/* Arduino core.                                                        */
+/************************************************************************/
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (pin < HOST_PINS) {
+        host.pin[pin] = val ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin)
+{
+    return host_pin(pin);
+}
+
+void analogWrite(uint8_t pin, int val)
+{
+    if (pin < HOST_PINS) {
+        host.pwm[pin] = (int16_t) constrain(val, 0, 255);
+    }
+}
+
+unsigned long millis(void)
+{
+    host_cost(HOST_CALL_COST);
+
+    return (unsigned long) (host.time / 1000);
+}
+
+unsigned long micros(void)
+{
+    host_cost(HOST_CALL_COST);
+
+    return (unsigned long) host.time;
+}
+
+void delay(unsigned long ms)
+{
+    host_advance((uint32_t) (ms * 1000));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    host_advance(us);
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+/************************************************************************/
+/* Atomic blocks (util/atomic.h).                                       */
+/************************************************************************/
+host_atomic_guard::host_atomic_guard(int _type)
+{
+    type = _type;
+    enabled = host.interrupts;
+    host.interrupts = false;
+
+    host_cost(HOST_CALL_COST);
+}
+
+host_atomic_guard::~host_atomic_guard()
+{
+    host.interrupts = (type == ATOMIC_FORCEON) ? true : enabled;
+
+    /// Serves a match from within the block.
+    if (host.interrupts && host.tick_flag) {
+        host.tick_flag = false;
+        host_interrupt();
+    }
+}
+
+/************************************************************************/
+/* Watchdog (avr/wdt.h).                                                */
+/************************************************************************/
+void wdt_enable(uint8_t timeout)
+{
+}
+
+void wdt_disable(void)
+{
+}
+
+void wdt_reset(void)
+{
+}
+
+/************************************************************************/
+/* Sonar (NewPing.h). The ping takes the echo time, or the time out     */
+/* when there is no echo.                                               */
+/************************************************************************/
+NewPing::NewPing(uint8_t _trigger_pin, uint8_t echo_pin, unsigned int _max_cm_distance)
+{
+    trigger_pin = _trigger_pin;
+    max_cm_distance = _max_cm_distance;
+}
+
+unsigned long NewPing::ping_cm(unsigned int _max_cm_distance)
+{
+    unsigned int limit = (_max_cm_distance != 0) ? _max_cm_distance : max_cm_distance;
+    unsigned long echo = (host.ping != 0) ? host.ping(trigger_pin, limit) : NO_ECHO;
+
+    if (echo > limit) {
+        echo = NO_ECHO;
+    }
+
+    host_cost(HOST_PING_COST + ((echo != NO_ECHO) ? echo : (limit + 1)) * HOST_US_ROUNDTRIP_CM);
+
+    return echo;
+}
+
+/************************************************************************/
+/* I2C bus (Wire.h) with the HMC6352 compass.                           */
+/************************************************************************/
+void TwoWire::begin(void)
+{
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    host.wire_tx_length = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (host.wire_tx_length >= sizeof(host.wire_tx)) {
+        return 0;
+    }
+
+    host.wire_tx[host.wire_tx_length++] = data;
+
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(void)
+{
+    host_cost(HOST_WIRE_COST);
+
+    if (host.wire_tx_length == 0) {
+        return 0;
+    }
+
+    switch (host.wire_tx[0]) {
+        /// Measures a heading (standby mode).
+        case 'A' :
+            host.compass_measurement = (host.heading != 0) ? host.heading() : 0;
+            host.compass_measured = true;
+            break;
+        /// Writes to RAM.
+        case 'G' :
+            if ((host.wire_tx_length >= 3) && (host.wire_tx[1] == HOST_COMPASS_RAM_MODE)) {
+                host.compass_mode = host.wire_tx[2];
+            }
+            break;
+        /// Reads from RAM.
+        case 'g' :
+            if (host.wire_tx_length >= 2) {
+                host.compass_ram_address = host.wire_tx[1];
+            }
+            break;
+    }
+
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+    host_cost(HOST_WIRE_COST);
+
+    host.wire_rx_index = 0;
+    host.wire_rx_length = 0;
+
+    if (address != HOST_COMPASS_ADDRESS) {
+        return 0;
+    }
+
+    /// The RAM byte asked for by the latest 'g' command.
+    if (quantity == 1) {
+        host.wire_rx[0] = (host.compass_ram_address == HOST_COMPASS_RAM_MODE) ? host.compass_mode : 0;
+        host.wire_rx_length = 1;
+
+    /// The heading: the latest measurement in standby mode, the current one otherwise.
+    } else if (quantity == 2) {
+        uint16_t heading = host.compass_measured ? host.compass_measurement :
+            ((host.heading != 0) ? host.heading() : 0);
+
+        host.compass_measured = false;
+        host.wire_rx[0] = (uint8_t) (heading >> 8);
+        host.wire_rx[1] = (uint8_t) (heading & 0xFF);
+        host.wire_rx_length = 2;
+    }
+
+    return host.wire_rx_length;
+}
+
+int TwoWire::available(void)
+{
+    return host.wire_rx_length - host.wire_rx_index;
+}
+
+int TwoWire::read(void)
+{
+    return (host.wire_rx_index < host.wire_rx_length) ? host.wire_rx[host.wire_rx_index++] : -1;
+}
+
+/************************************************************************/
+/* Serial port. Numbers print like the Arduino core on the robot (32    */
+/* bit longs).                                                          */
+/************************************************************************/
+void HardwareSerial::begin(unsigned long baud)
+{
+    host.baud = baud;
+}
+
+void HardwareSerial::end(void)
+{
+    host.baud = 0;
+}
+
+int HardwareSerial::available(void)
+{
+    return (int) host.serial_in.size();
+}
+
+int HardwareSerial::peek(void)
+{
+    return host.serial_in.empty() ? -1 : (uint8_t) host.serial_in[0];
+}
+
+int HardwareSerial::read(void)
+{
+    int data = peek();
+
+    if (data >= 0) {
+        host.serial_in.erase(0, 1);
+    }
+
+    return data;
+}
+
+void HardwareSerial::flush(void)
+{
+    if (host.costs && (host.serial_done > host.time)) {
+        host_advance((uint32_t) (host.serial_done - host.time));
+    }
+}
+
+size_t HardwareSerial::write(uint8_t data)
+{
+    host_serial_put(data);
+
+    return 1;
+}
+
+size_t HardwareSerial::write(const char *string)
+{
+    size_t n = 0;
+
+    while (string[n] != '\0') {
+        host_serial_put((uint8_t) string[n++]);
+    }
+
+    return n;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        host_serial_put(buffer[i]);
+    }
+
+    return size;
+}
+
+size_t HardwareSerial::print(const __FlashStringHelper *string)
+{
+    return write(reinterpret_cast<const char *>(string));
+}
+
+size_t HardwareSerial::print(const char *string)
+{
+    return write(string);
+}
+
+size_t HardwareSerial::print(char c)
+{
+    return write((uint8_t) c);
+}
+
+size_t HardwareSerial::print(unsigned char n, int base)
+{
+    return print((unsigned long) n, base);
+}
+
+size_t HardwareSerial::print(int n, int base)
+{
+    return print((long) n, base);
+}
+
+size_t HardwareSerial::print(unsigned int n, int base)
+{
+    return print((unsigned long) n, base);
+}
+
+size_t HardwareSerial::print(long n, int base)
+{
+    if ((base == DEC) && (n < 0)) {
+        return print('-') + print_number((unsigned long) -n, DEC);
+    }
+
+    return print_number((uint32_t) n, (uint8_t) base);
+}
+
+size_t HardwareSerial::print(unsigned long n, int base)
+{
+    return print_number(n, (uint8_t) base);
+}
+
+size_t HardwareSerial::print(double n, int digits)
+{
+    return print_float(n, (uint8_t) digits);
+}
+
+size_t HardwareSerial::println(const __FlashStringHelper *string)
+{
+    return print(string) + println();
+}
+
+size_t HardwareSerial::println(const char *string)
+{
+    return print(string) + println();
+}
+
+size_t HardwareSerial::println(char c)
+{
+    return print(c) + println();
+}
+
+size_t HardwareSerial::println(unsigned char n, int base)
+{
+    return print(n, base) + println();
+}
+
+size_t HardwareSerial::println(int n, int base)
+{
+    return print(n, base) + println();
+}
+
+size_t HardwareSerial::println(unsigned int n, int base)
+{
+    return print(n, base) + println();
+}
+
+size_t HardwareSerial::println(long n, int base)
+{
+    return print(n, base) + println();
+}
+
+size_t HardwareSerial::println(unsigned long n, int base)
+{
+    return print(n, base) + println();
+}
+
+size_t HardwareSerial::println(double n, int digits)
+{
+    return print(n, digits) + println();
+}
+
+size_t HardwareSerial::println(void)
+{
+    return write("\r\n");
+}
+
+/************************************************************************/
+/* Help function to print a number (@param n) in a base (@param base).  */
+/************************************************************************/
+size_t HardwareSerial::print_number(unsigned long n, uint8_t base)
+{
+    char buffer[8 * sizeof(long) + 1];
+    char *digit = &buffer[sizeof(buffer) - 1];
+
+    *digit = '\0';
+
+    if (base < 2) {
+        base = DEC;
+    }
+
+    do {
+        char c = (char) (n % base);
+
+        n /= base;
+        *--digit = (c < 10) ? (c + '0') : (c + 'A' - 10);
+    } while (n != 0);
+
+    return write(digit);
+}
+
+/************************************************************************/
+/* Help function to print a number (@param n) with a number of decimals */
+/* (@param digits), rounded like the Arduino core does.                 */
+/************************************************************************/
+size_t HardwareSerial::print_float(double n, uint8_t digits)
+{
+    size_t length = 0;
+
+    if (isnan(n)) {
+        return print("nan");
+    }
+
+    if (isinf(n)) {
+        return print("inf");
+    }
+
+    if ((n > 4294967040.0) || (n < -4294967040.0)) {
+        return print("ovf");
+    }
+
+    if (n < 0.0) {
+        length += print('-');
+        n = -n;
+    }
+
+    double rounding = 0.5;
+
+    for (uint8_t i = 0; i < digits; i++) {
+        rounding /= 10.0;
+    }
+
+    n += rounding;
+
+    unsigned long whole = (unsigned long) n;
+    double remainder = n - (double) whole;
+
+    length += print(whole);
+
+    if (digits > 0) {
+        length += print('.');
+    }
+
+    while (digits-- > 0) {
+        remainder *= 10.0;
+
+        unsigned int digit = (unsigned int) remainder;
+
+        length += print(digit);
+        remainder -= digit;
+    }
+
+    return length;
+}
+
+/************************************************************************/
+/* Help function to let a call take some time (@param us), while the    */
+/* costs are on.                                                        */
+/************************************************************************/
+static void host_cost(uint32_t us)
+{
+    if (host.costs) {
+        host_advance(us);
+    }
+}
+
+/************************************************************************/
+/* Help function to start Timer4 as soon as timer4_init() enabled it.   */
+/************************************************************************/
+static void host_timer_check(void)
+{
+    bool running = ((TIMSK4 & (1 << OCIE4B)) != 0) && ((TCCR4B & ((1 << CS42) | (1 << CS41) | (1 << CS40))) != 0);
+
+    if (running && !host.timer_running) {
+        host.tick_time = host.time + (OCR4A + 1UL) * HOST_TIMER4_US_PER_COUNT;
+    }
+
+    host.timer_running = running;
+}
+
+/************************************************************************/
+/* Help function to raise the Timer4 interrupt. While the interrupts    */
+/* are disabled only the flag is set, like on the robot.                */
+/************************************************************************/
+static void host_interrupt(void)
+{
+    if (!host.interrupts) {
+        host.tick_flag = true;
+        return;
+    }
+
+    host.interrupts = false;
+    TIMER4_COMPB_vect();
+    host.interrupts = true;
+}
+
+/************************************************************************/
+/* Help function to send one byte (@param data) over the serial port.   */
+/* The call waits while the transmit buffer is full.                    */
+/************************************************************************/
+static void host_serial_put(uint8_t data)
+{
+    host.serial_out += (char) data;
+
+    if (host.serial_echo) {
+        fputc(data, stdout);
+    }
+
+    if (!host.costs || (host.baud == 0)) {
+        return;
+    }
+
+    uint64_t byte_time = (HOST_SERIAL_BITS * 1000000UL) / host.baud;
+    uint64_t start = (host.serial_done > host.time) ? host.serial_done : host.time;
+
+    host.serial_done = start + byte_time;
+
+    /// Waits for room in the buffer.
+    if (host.serial_done > host.time + HOST_SERIAL_BUFFER * byte_time) {
+        host_advance((uint32_t) (host.serial_done - host.time - HOST_SERIAL_BUFFER * byte_time));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+/************************************************************************/
+/* Arduino.h - The host version of the Arduino core.                    */
+/*                                                                      */
+/* Only the parts the robot uses. Time, pins, registers and the serial  */
+/* port belong to the simulated hardware of the calling thread (see     */
+/* hal.cpp), so every thread runs a robot of its own.                   */
+/************************************************************************/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+/// System headers first - the macros below would break their declarations.
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH  1
+#define LOW   0
+
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+
+#define BIN  2
+#define OCT  8
+#define DEC  10
+#define HEX  16
+
+#define F_CPU  16000000UL
+
+/// Same macros as the Arduino core (they evaluate their arguments twice).
+#define min(a, b)  ((a) < (b) ? (a) : (b))
+#define max(a, b)  ((a) > (b) ? (a) : (b))
+#define abs(x)     ((x) > 0 ? (x) : -(x))
+#define constrain(amt, low, high)  ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define radians(deg)  ((deg) * DEG_TO_RAD)
+#define degrees(rad)  ((rad) * RAD_TO_DEG)
+
+#define PI          3.1415926535897932384626433832795
+#define DEG_TO_RAD  0.017453292519943295769236907684886
+#define RAD_TO_DEG  57.295779513082320876798154814105
+
+/// Strings in flash are plain strings on the host.
+class __FlashStringHelper;
+#define F(string_literal)  (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+#define PROGMEM
+
+/// Interrupt service routines are plain functions, called by the simulated timer.
+#define ISR(vector)  extern "C" void vector(void)
+
+/// Heap bounds (avr-libc), always empty on the host.
+extern char *__brkval;
+extern char *__malloc_heap_start;
+
+/************************************************************************/
+/* Registers of the timers the robot uses.                              */
+/************************************************************************/
+extern thread_local volatile uint8_t MCUSR;
+extern thread_local volatile uint8_t TIMSK4;
+extern thread_local volatile uint8_t TCCR3A, TCCR3B, TCCR4A, TCCR4B, TCCR5A, TCCR5B;
+extern thread_local volatile uint16_t ICR3, ICR5;
+extern thread_local volatile uint16_t OCR3A, OCR3B, OCR4A, OCR5A, OCR5B, OCR5C;
+
+/// Reset flags (MCUSR).
+#define PORF   0
+#define EXTRF  1
+#define BORF   2
+#define WDRF   3
+
+/// Timer register bits.
+#define WGM31  1
+#define WGM32  3
+#define WGM33  4
+#define CS31   1
+#define COM3B1  5
+#define COM3A1  7
+
+#define WGM42   3
+#define CS40    0
+#define CS41    1
+#define CS42    2
+#define OCIE4B  2
+
+#define WGM51  1
+#define WGM52  3
+#define WGM53  4
+#define CS51   1
+#define COM5C1  3
+#define COM5B1  5
+#define COM5A1  7
+
+/************************************************************************/
+/* Pins and time.                                                       */
+/************************************************************************/
+void pinMode(uint8_t, uint8_t);
+void digitalWrite(uint8_t, uint8_t);
+int digitalRead(uint8_t);
+void analogWrite(uint8_t, int);
+unsigned long millis(void);
+unsigned long micros(void);
+long map(long, long, long, long, long);
+void delay(unsigned long);
+void delayMicroseconds(unsigned int);
+
+/************************************************************************/
+/* Serial port. Prints like the Arduino core, into the output of the    */
+/* simulated hardware (see host.h).                                     */
+/************************************************************************/
+class HardwareSerial {
+public:
+    void begin(unsigned long);
+    void end(void);
+    int available(void);
+    int peek(void);
+    int read(void);
+    void flush(void);
+    size_t write(uint8_t);
+    size_t write(const char *);
+    size_t write(const uint8_t *, size_t);
+
+    size_t print(const __FlashStringHelper *);
+    size_t print(const char *);
+    size_t print(char);
+    size_t print(unsigned char, int = DEC);
+    size_t print(int, int = DEC);
+    size_t print(unsigned int, int = DEC);
+    size_t print(long, int = DEC);
+    size_t print(unsigned long, int = DEC);
+    size_t print(double, int = 2);
+
+    size_t println(const __FlashStringHelper *);
+    size_t println(const char *);
+    size_t println(char);
+    size_t println(unsigned char, int = DEC);
+    size_t println(int, int = DEC);
+    size_t println(unsigned int, int = DEC);
+    size_t println(long, int = DEC);
+    size_t println(unsigned long, int = DEC);
+    size_t println(double, int = 2);
+    size_t println(void);
+
+    operator bool() { return true; }
+
+private:
+    size_t print_number(unsigned long, uint8_t);
+    size_t print_float(double, uint8_t);
+};
+
+extern HardwareSerial Serial;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+/************************************************************************/
+/* NewPing.h - The host version of the NewPing library.                 */
+/*                                                                      */
+/* The echo comes from the ping input of the simulated hardware (see    */
+/* host.h), told apart by the trigger pin.                              */
+/************************************************************************/
+
+#ifndef NEWPING_H
+#define NEWPING_H
+
+#include <stdint.h>
+
+#define NO_ECHO  0
+
+class NewPing {
+public:
+    NewPing(uint8_t, uint8_t, unsigned int = 500);
+    unsigned long ping_cm(unsigned int = 0);
+
+private:
+    uint8_t trigger_pin;
+    unsigned int max_cm_distance;
+};
+
+#endif
\ No newline at end of file
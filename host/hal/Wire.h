@@ -0,0 +1,27 @@
+/************************************************************************/
+/* Wire.h - The host version of the Wire (I2C) library.                 */
+/*                                                                      */
+/* The only device on the bus is the HMC6352 compass, emulated in       */
+/* hal.cpp.                                                             */
+/************************************************************************/
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class TwoWire {
+public:
+    void begin(void);
+    void beginTransmission(uint8_t);
+    uint8_t endTransmission(void);
+    uint8_t requestFrom(uint8_t, uint8_t);
+    size_t write(uint8_t);
+    int available(void);
+    int read(void);
+};
+
+extern TwoWire Wire;
+
+#endif
\ No newline at end of file
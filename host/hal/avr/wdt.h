@@ -0,0 +1,25 @@
+/************************************************************************/
+/* avr/wdt.h - The host version of the avr-libc watchdog functions.     */
+/*                                                                      */
+/* The simulated buses never hang, so the watchdog never bites.         */
+/************************************************************************/
+
+#ifndef AVR_WDT_H
+#define AVR_WDT_H
+
+#include <stdint.h>
+
+#define WDTO_15MS   0
+#define WDTO_30MS   1
+#define WDTO_60MS   2
+#define WDTO_120MS  3
+#define WDTO_250MS  4
+#define WDTO_500MS  5
+#define WDTO_1S     6
+#define WDTO_2S     7
+
+void wdt_enable(uint8_t);
+void wdt_disable(void);
+void wdt_reset(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,27 @@
+/************************************************************************/
+/* util/atomic.h - The host version of the avr-libc atomic blocks.      */
+/*                                                                      */
+/* Disables the simulated interrupts for the block. A Timer4 match      */
+/* meanwhile is served when the block ends, also on return or break.    */
+/************************************************************************/
+
+#ifndef UTIL_ATOMIC_H
+#define UTIL_ATOMIC_H
+
+#define ATOMIC_RESTORESTATE  0
+#define ATOMIC_FORCEON       1
+
+/// Disables the interrupts while it exists.
+class host_atomic_guard {
+public:
+    explicit host_atomic_guard(int);
+    ~host_atomic_guard();
+
+private:
+    int type;
+    bool enabled;
+};
+
+#define ATOMIC_BLOCK(type)  for (host_atomic_guard host_guard(type), *host_once = &host_guard; host_once; host_once = 0)
+
+#endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+/************************************************************************/
+/* host.h - The .h file for the simulated hardware of the host build.   */
+/*                                                                      */
+/* Everything the firmware sees through the Arduino core, Wire and      */
+/* NewPing is simulated per thread: a virtual clock with the Timer4     */
+/* interrupt, the pins, the serial port, the HMC6352 compass and the    */
+/* sonar echoes. The inputs come from callbacks, so the same firmware   */
+/* runs against a recording (replay.cpp) or a simulated arena.          */
+/*                                                                      */
+/* Not included by the firmware - keep the Arduino macros out of here.  */
+/************************************************************************/
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <string>
+
+/// Returns the echo (cm, 0 for none) of the sensor with a trigger pin (@param 1)
+/// within a distance (@param 2, cm).
+typedef unsigned long (*host_ping_t)(uint8_t, unsigned int);
+
+/// Returns the compass heading (0-3599, tenths of degrees).
+typedef uint16_t (*host_heading_t)(void);
+
+/************************************************************************/
+/* Declaration of functions used in hal.cpp (needed elsewhere).         */
+/************************************************************************/
+void host_begin(host_ping_t, host_heading_t);
+void host_costs(bool);
+void host_advance(uint32_t);
+void host_next_tick(void);
+uint64_t host_time(void);
+uint8_t host_pin(uint8_t);
+int16_t host_pwm(uint8_t);
+void host_serial_echo(bool);
+void host_serial_send(const char *);
+std::string host_serial_take(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,298 @@
+/************************************************************************/
+/* replay.cpp - The .cpp file for replaying captured runs on the host.  */
+/*                                                                      */
+/* Reads a capture (the serial output of a run with REPLAY_CAPTURE in   */
+/* robot.h) and feeds its inputs to the unchanged firmware: sensor      */
+/* readings, compass headings and commands, and serial commands, each   */
+/* after the tick it was recorded at. Every record the firmware makes   */
+/* is compared with the capture, so any change in the state logic       */
+/* shows as the first record that differs.                              */
+/*                                                                      */
+/* The ticks are run back to back on a virtual clock, so the replay is  */
+/* the same on every run and takes a fraction of the run time.          */
+/*                                                                      */
+/* Usage: robot_replay <capture> [-v]                                   */
+/*   -v  prints the serial output of the firmware                       */
+/************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "host.h"
+#include "Arduino.h"
+#include "compass.h"
+#include "recorder.h"
+#include "robot.h"
+#include "sensor.h"
+#include "timer.h"
+
+/// Number of differing records printed.
+#define REPLAY_PRINT_MAX  10
+
+/// Functions of robot.ino.
+void setup(void);
+void control_tick(void);
+void use_reading(uint8_t);
+void serial_command(int);
+
+/// The captured records, the records of the replay and its unfinished serial line.
+static std::vector<record_t> replay_capture;
+static std::vector<record_t> replay_records;
+static std::string replay_line;
+
+/// Index of the captured compass heading the compass reads next.
+static size_t replay_compass = 0;
+
+/// Pre-declaration of help functions.
+static bool replay_load(const char *);
+static bool replay_parse(const std::string &, record_t *);
+static uint16_t replay_heading(void);
+static void replay_tick(void);
+static void replay_input(size_t);
+static void replay_collect(void);
+static uint32_t replay_compare(void);
+static void replay_print(const char *, const record_t *);
+
+/************************************************************************/
+/* Replays a capture. @returns 0 when the replay made the same records, */
+/* 1 when it did not and 2 on errors.                                   */
+/************************************************************************/
+int main(int argc, char **argv)
+{
+    if ((argc < 2) || ((argc > 2) && (strcmp(argv[2], "-v") != 0))) {
+        fprintf(stderr, "Usage: %s <capture> [-v]\n", argv[0]);
+        return 2;
+    }
+
+    if (!replay_load(argv[1])) {
+        return 2;
+    }
+
+    host_begin(0, replay_heading);
+    host_serial_echo(argc > 2);
+
+    /// Boots like the robot did. The compass reads the headings captured at boot.
+    setup();
+    replay_collect();
+
+    /// From here on only the replay moves the time.
+    host_costs(false);
+
+    for (size_t i = 0; i < replay_capture.size(); i++) {
+        const record_t *record = &replay_capture[i];
+
+        /// Outputs are made by the replay, headings read at boot are used up.
+        if ((record->type < RECORD_BUCKET_SENSOR) || ((record->type > RECORD_COMPASS) && (record->type < RECORD_COMPASS_COMMAND)) ||
+            ((record->type == RECORD_COMPASS) && (i < replay_compass))) {
+            continue;
+        }
+
+        /// Runs the ticks up to the tick of the input.
+        while (timer_now() < record->tick) {
+            replay_tick();
+        }
+
+        replay_input(i);
+        replay_collect();
+    }
+
+    /// Runs the ticks after the last input.
+    while (timer_now() < replay_capture.back().tick) {
+        replay_tick();
+    }
+
+    replay_collect();
+
+    uint32_t run_ms = TICKS_TO_MS(timer_now());
+    uint32_t differences = replay_compare();
+
+    printf("Replayed %lu records, %lu.%03lu s of run time: %lu differ\n",
+        (unsigned long) replay_capture.size(), (unsigned long) (run_ms / 1000),
+        (unsigned long) (run_ms % 1000), (unsigned long) differences);
+
+    return (differences == 0) ? 0 : 1;
+}
+
+/************************************************************************/
+/* Help function to read the records of a capture (@param path).        */
+/* Everything else the robot printed is skipped.                        */
+/* @returns false when there is nothing to replay.                      */
+/************************************************************************/
+static bool replay_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char buffer[256];
+
+    if (file == 0) {
+        fprintf(stderr, "Can't open %s\n", path);
+        return false;
+    }
+
+    while (fgets(buffer, sizeof(buffer), file) != 0) {
+        record_t record;
+
+        if (replay_parse(buffer, &record)) {
+            replay_capture.push_back(record);
+        }
+    }
+
+    fclose(file);
+
+    if (replay_capture.empty()) {
+        fprintf(stderr, "No records in %s - was it captured with REPLAY_CAPTURE?\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+/************************************************************************/
+/* Help function to parse a streamed record (@param line, "R tick type  */
+/* id value") into @param record. @returns false for other lines.       */
+/************************************************************************/
+static bool replay_parse(const std::string &line, record_t *record)
+{
+    unsigned long tick;
+    unsigned int type;
+    unsigned int id;
+    int value;
+
+    if ((line.compare(0, 2, "R ") != 0) || (sscanf(line.c_str() + 2, "%lu %u %u %d", &tick, &type, &id, &value) != 4)) {
+        return false;
+    }
+
+    record->tick  = (uint32_t) tick;
+    record->type  = (uint8_t) type;
+    record->id    = (uint8_t) id;
+    record->value = (int16_t) value;
+
+    return true;
+}
+
+/************************************************************************/
+/* Help function that @returns the next captured heading as read from   */
+/* the compass (0-3599).                                                */
+/************************************************************************/
+static uint16_t replay_heading(void)
+{
+    static int16_t heading = 0;
+
+    while ((replay_compass < replay_capture.size()) && (replay_capture[replay_compass].type != RECORD_COMPASS)) {
+        replay_compass++;
+    }
+
+    /// The firmware reads more headings than captured - the replay has gone its own way.
+    if (replay_compass < replay_capture.size()) {
+        heading = replay_capture[replay_compass++].value;
+    }
+
+    return (uint16_t) (((heading < 0) ? (heading + 360) : heading) * 10);
+}
+
+/************************************************************************/
+/* Help function to run one tick, like run_ticks() on the robot.        */
+/************************************************************************/
+static void replay_tick(void)
+{
+    /// A tick may be left over from setup().
+    if (!timer_take_tick()) {
+        host_next_tick();
+        timer_take_tick();
+    }
+
+    control_tick();
+}
+
+/************************************************************************/
+/* Help function to feed one captured input (@param index) to the       */
+/* firmware, the same way the main loop does on the robot.              */
+/************************************************************************/
+static void replay_input(size_t index)
+{
+    const record_t *record = &replay_capture[index];
+
+    switch (record->type) {
+        case RECORD_BUCKET_SENSOR :
+            sonar_store(BUCKET_SONAR, (uint8_t) record->value);
+            use_reading(BUCKET_SONAR);
+            break;
+        case RECORD_TOP_SENSOR :
+            sonar_store(TOP_SONAR, (uint8_t) record->value);
+            use_reading(TOP_SONAR);
+            break;
+        /// The compass reads this heading.
+        case RECORD_COMPASS :
+            replay_compass = index;
+            compass_update(GET_HEADING);
+            break;
+        /// The pending command is sent instead of a heading.
+        case RECORD_COMPASS_COMMAND :
+            compass_update(GET_HEADING);
+            break;
+        case RECORD_COMMAND :
+            serial_command(record->value);
+            break;
+    }
+}
+
+/************************************************************************/
+/* Help function to collect the records streamed by the firmware.       */
+/************************************************************************/
+static void replay_collect(void)
+{
+    replay_line += host_serial_take();
+
+    size_t end;
+
+    while ((end = replay_line.find('\n')) != std::string::npos) {
+        record_t record;
+
+        if (replay_parse(replay_line.substr(0, end), &record)) {
+            replay_records.push_back(record);
+        }
+
+        replay_line.erase(0, end + 1);
+    }
+}
+
+/************************************************************************/
+/* Help function to compare the records of the replay with the capture. */
+/* Prints the first differences. @returns the number of differences.    */
+/************************************************************************/
+static uint32_t replay_compare(void)
+{
+    size_t length = max(replay_capture.size(), replay_records.size());
+    uint32_t differences = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        const record_t *expected = (i < replay_capture.size()) ? &replay_capture[i] : 0;
+        const record_t *replayed = (i < replay_records.size()) ? &replay_records[i] : 0;
+
+        if ((expected != 0) && (replayed != 0) && (memcmp(expected, replayed, sizeof(record_t)) == 0)) {
+            continue;
+        }
+
+        if (differences++ < REPLAY_PRINT_MAX) {
+            printf("Record %lu:\n", (unsigned long) i);
+            replay_print("  captured: ", expected);
+            replay_print("  replayed: ", replayed);
+        }
+    }
+
+    return differences;
+}
+
+/************************************************************************/
+/* Help function to print a record (@param record) after a label        */
+/* (@param label).                                                      */
+/************************************************************************/
+static void replay_print(const char *label, const record_t *record)
+{
+    if (record == 0) {
+        printf("%s-\n", label);
+        return;
+    }
+
+    printf("%s%lu %u %u %d\n", label, (unsigned long) record->tick, record->type, record->id, record->value);
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+/************************************************************************/
+/* scenarios.cpp - The .cpp file for the KPI regression scenarios.      */
+/*                                                                      */
+/* Runs the firmware through a library of seeded arenas (sim.cpp): ball */
+/* layouts, start poses, compass disturbance, sonar noise and lost      */
+/* echoes. Each run is checked against the KPI baselines of config.h    */
+/* (the "pass" of kpi_report()) and against the wall collisions allowed */
+/* in its arena. The seeds make every run the same each time, and the   */
+/* scenarios run side by side on all cores.                             */
+/*                                                                      */
+/* Usage: robot_scenarios [-v] [-o <file>] [scenario]                   */
+/*   -v         prints the KPI report of each run (time per state)      */
+/*   -o <file>  writes the serial output of the scenario to a file,     */
+/*              with the capture build a capture for robot_replay       */
+/*              (the baselines are not checked)                         */
+/************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "host.h"
+#include "sim.h"
+
+/// One scenario and the most wall collisions allowed in its run.
+typedef struct {
+    sim_scenario_t scenario;
+    uint16_t max_collisions;
+} scenario_t;
+
+/// The scenario library.
+/// name, seed, balls, layout, start x/y/heading, compass north/disturbance/noise,
+/// sonar noise/dropout/ghost, wheel ratio, run time (ms); most collisions.
+static const scenario_t scenarios[] = {
+    {{"clean",      101, 8,  SIM_BALLS_SCATTERED, 0,   0,   0,  0,   0,  0,   0,   0,    0,    1.00f, 120000}, 2},
+    {{"scattered",  202, 8,  SIM_BALLS_SCATTERED, 0,   0,   0,  40,  0,  0.5, 1,   0.05, 0.01, 1.00f, 120000}, 2},
+    {{"cluster",    303, 8,  SIM_BALLS_CLUSTERED, 0,   0,   0,  130, 0,  0.5, 1,   0.05, 0.01, 1.00f, 120000}, 2},
+    {{"walls",      404, 8,  SIM_BALLS_WALLS,     0,   0,   0,  220, 0,  0.5, 1,   0.05, 0.01, 1.00f, 120000}, 2},
+    {{"offset",     505, 8,  SIM_BALLS_SCATTERED, 10,  -30, 8,  310, 0,  0.5, 1,   0.05, 0.01, 0.95f, 120000}, 2},
+    {{"disturbed",  606, 8,  SIM_BALLS_SCATTERED, 0,   20,  -5, 75,  15, 1,   1,   0.05, 0.01, 1.00f, 120000}, 2},
+    {{"noisy",      707, 8,  SIM_BALLS_SCATTERED, 0,   0,   0,  180, 5,  1,   2,   0.20, 0.03, 1.00f, 120000}, 3},
+};
+
+#define SCENARIO_COUNT  (sizeof(scenarios) / sizeof(scenarios[0]))
+
+/// Outcome of a scenario.
+typedef struct {
+    bool complete;
+    sim_result_t result;
+    std::string report;
+    std::string log;
+} outcome_t;
+
+/// Pre-declaration of help functions.
+static void scenario_worker(std::vector<const scenario_t *> *, std::vector<outcome_t> *, std::atomic<size_t> *, bool);
+static bool scenario_print(const scenario_t *, const outcome_t *, bool);
+
+/************************************************************************/
+/* Runs the scenarios. @returns 0 when all of them met their baselines, */
+/* 1 when one did not and 2 on errors.                                  */
+/************************************************************************/
+int main(int argc, char **argv)
+{
+    const char *name = 0;
+    const char *output = 0;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc)) {
+            output = argv[++i];
+        } else if ((argv[i][0] != '-') && (name == 0)) {
+            name = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [-v] [-o <file>] [scenario]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<const scenario_t *> selected;
+
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        if ((name == 0) || (strcmp(name, scenarios[i].scenario.name) == 0)) {
+            selected.push_back(&scenarios[i]);
+        }
+    }
+
+    if (selected.empty()) {
+        fprintf(stderr, "No scenario %s\n", name);
+        return 2;
+    }
+
+    if ((output != 0) && (selected.size() != 1)) {
+        fprintf(stderr, "-o needs one scenario\n");
+        return 2;
+    }
+
+    /// Every thread runs a robot of its own (RUN_LOCAL, hal.cpp and sim.cpp).
+    std::vector<outcome_t> outcomes(selected.size());
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next(0);
+    unsigned cores = std::thread::hardware_concurrency();
+
+    for (unsigned i = 0; (i < selected.size()) && (i < ((cores != 0) ? cores : 1)); i++) {
+        workers.push_back(std::thread(scenario_worker, &selected, &outcomes, &next, output != 0));
+    }
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    printf("%-10s %8s %8s %6s %8s %6s %8s %7s %8s %9s  %s\n", "scenario", "first_ms", "caught", "launch",
+        "per_min", "thrown", "wall/min", "compass", "overruns", "collision", "result");
+
+    bool ok = true;
+
+    for (size_t i = 0; i < selected.size(); i++) {
+        ok &= scenario_print(selected[i], &outcomes[i], verbose);
+    }
+
+    if (output != 0) {
+        FILE *file = fopen(output, "w");
+
+        if ((file == 0) || (fputs(outcomes[0].log.c_str(), file) < 0)) {
+            fprintf(stderr, "Can't write %s\n", output);
+            return 2;
+        }
+
+        fclose(file);
+
+        /// The output is for a replay. Streaming a capture delays the loop, so the run
+        /// is not the one checked against the baselines.
+        return 0;
+    }
+
+    return ok ? 0 : 1;
+}
+
+/************************************************************************/
+/* Help function to run scenarios (@param selected) until none is left, */
+/* taking the next one from @param next, into @param outcomes. Keeps    */
+/* the serial output when @param log is set.                            */
+/************************************************************************/
+static void scenario_worker(std::vector<const scenario_t *> *selected, std::vector<outcome_t> *outcomes, std::atomic<size_t> *next, bool log)
+{
+    for (size_t i = (*next)++; i < selected->size(); i = (*next)++) {
+        outcome_t *outcome = &(*outcomes)[i];
+
+        outcome->complete = sim_run(&(*selected)[i]->scenario, &outcome->result, &outcome->report, log ? &outcome->log : 0);
+    }
+}
+
+/************************************************************************/
+/* Help function to print the outcome (@param outcome) of a scenario    */
+/* (@param scenario), with the KPI report when @param verbose is set.   */
+/* @returns whether the scenario met its baselines or not.              */
+/************************************************************************/
+static bool scenario_print(const scenario_t *scenario, const outcome_t *outcome, bool verbose)
+{
+    const sim_result_t *result = &outcome->result;
+    bool ok = outcome->complete && result->pass && (result->collisions <= scenario->max_collisions);
+
+    if (!outcome->complete) {
+        printf("%-10s no KPI report  FAIL\n", scenario->scenario.name);
+        return false;
+    }
+
+    printf("%-10s %8ld %8ld %6ld %5ld.%ld %6u %6ld.%ld %7ld %8ld %5u/%-3u  %s\n", scenario->scenario.name,
+        (long) result->first_launch_ms, (long) result->balls_caught, (long) result->launches,
+        (long) (result->launch_rate / 10), (long) (result->launch_rate % 10), result->launched,
+        (long) (result->wall_turn_rate / 10), (long) (result->wall_turn_rate % 10), (long) result->compass_timeouts,
+        (long) result->budget_overruns, result->collisions, scenario->max_collisions, ok ? "ok" : "FAIL");
+
+    if (verbose) {
+        fputs(outcome->report.c_str(), stdout);
+    }
+
+    return ok;
+}
\ No newline at end of file
@@ -0,0 +1,617 @@
+/************************************************************************/
+/* sim.cpp - The .cpp file for the simulated arena of the host build.   */
+/*                                                                      */
+/* The arena is the own half of the field: the mid wall at x = 0, the   */
+/* back wall behind the start position and the side walls, with x along */
+/* the start heading and y to the right (the frame of nav.cpp). The     */
+/* world moves in 1 ms steps whenever the firmware looks at it, on the  */
+/* outputs it has set: brakes, directions and PWM of the motor shield   */
+/* and the servo pulses. All of it is per thread, like the hardware in  */
+/* hal.cpp, and every random number comes from the seed of the run.     */
+/************************************************************************/
+
+#include <stdlib.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "host.h"
+#include "sim.h"
+#include "Arduino.h"
+#include "config.h"
+#include "kpi.h"
+
+/// Size of the arena half (cm). The start position is NAV_START_DISTANCE from the mid wall.
+#define SIM_ARENA_LENGTH  240
+#define SIM_ARENA_WIDTH   240
+
+/// Robot: radius of the body around the center between the wheels and the track (cm).
+#define SIM_ROBOT_RADIUS  15
+#define SIM_TRACK         25
+
+/// Wheel speed (cm/s) at two PWM duty cycles, the speed changes linearly in between
+/// and stops at 0. Acceleration and braking of the wheels (cm/s^2).
+#define SIM_PWM_LOW         100
+#define SIM_PWM_HIGH        120
+#define SIM_SPEED_LOW       20.0f
+#define SIM_SPEED_HIGH      30.0f
+#define SIM_ACCELERATION    150.0f
+
+/// Ball radius (cm) and the reach of the bucket in front of the body (cm, degrees).
+#define SIM_BALL_RADIUS   3.3f
+#define SIM_CATCH_REACH   12.0f
+#define SIM_CATCH_ANGLE   30.0f
+
+/// Wiring of the sensors (see README).
+#define SIM_BUCKET_TRIG_PIN  6
+#define SIM_TOP_TRIG_PIN     40
+
+/// Half angle of the sonar beams (degrees). Both sensors are at the front of the body,
+/// the bucket sensor sees balls and walls, the top sensor on its servo above the balls
+/// only walls.
+#define SIM_BUCKET_BEAM  15.0f
+#define SIM_TOP_BEAM     10.0f
+
+/// Distance of a held ball to the bucket sensor (cm).
+#define SIM_HELD_DISTANCE  4
+
+/// Walls seen this far (degrees) outside the beam still echo, less and less up to the
+/// specular limit, beyond it the sound is reflected away.
+#define SIM_SPECULAR_START  10.0f
+#define SIM_SPECULAR_LIMIT  40.0f
+
+/// Servo angle of the top sensor looking straight ahead (angles grow to the left).
+#define SIM_TOP_MID_ANGLE  75
+
+/// Servo pulse (same as servo.cpp): timer counts per us, pulse at 0 and 180 degrees.
+#define SIM_SERVO_COUNTS_PER_US  2
+#define SIM_SERVO_MIN_PULSE      544
+#define SIM_SERVO_MAX_PULSE      2400
+
+/// Servo angles where the bucket holds a ball, the lifting arm tips it into the catapult,
+/// the catapult arm is tightened and the lock lets go (degrees).
+#define SIM_BUCKET_IN_ANGLE   90
+#define SIM_ARM_UP_ANGLE      55
+#define SIM_CATAPULT_UP_ANGLE 100
+#define SIM_UNLOCKED_ANGLE    50
+
+/// Period of the compass disturbance over the arena (cm).
+#define SIM_DISTURBANCE_PERIOD  150.0f
+
+/// Time free of the walls before a contact counts as a new collision (ms).
+#define SIM_CONTACT_CLEAR_TIME  500
+
+/// Ball in the arena (cm).
+typedef struct {
+    float x;
+    float y;
+} sim_ball_t;
+
+/// The arena and the robot of this thread.
+typedef struct {
+    const sim_scenario_t *scenario;
+    std::mt19937 random;
+
+    /// Time the world has moved to (us).
+    uint64_t time;
+
+    /// Pose of the robot (cm, degrees clockwise from the start heading) and the
+    /// speed of the wheels (cm/s, RIGHT and LEFT).
+    float x;
+    float y;
+    float heading;
+    float wheel[2];
+
+    /// Balls in the arena, in the bucket and in the catapult.
+    std::vector<sim_ball_t> balls;
+    bool bucket_ball;
+    bool catapult_ball;
+
+    /// Servo angles at the previous step (degrees).
+    int16_t bucket_angle;
+    int16_t lock_angle;
+
+    /// Touching a wall, the time the robot got free and the counts of the run.
+    bool contact;
+    uint64_t free_time;
+    uint16_t collisions;
+    uint16_t launched;
+} sim_world_t;
+
+static thread_local sim_world_t sim;
+
+/// Functions of robot.ino.
+void setup(void);
+void loop(void);
+
+/// Pre-declaration of help functions.
+static void sim_place_balls(void);
+static bool sim_ball_free(float, float);
+static unsigned long sim_ping(uint8_t, unsigned int);
+static uint16_t sim_heading(void);
+static void sim_move(void);
+static void sim_step(void);
+static float sim_wheel_target(uint8_t, uint8_t, uint8_t);
+static void sim_drive(float);
+static void sim_push_balls(void);
+static void sim_servos(void);
+static int16_t sim_servo_angle(uint16_t);
+static float sim_wall_echo(float, float, float, float);
+static float sim_ball_echo(float, float, float, float);
+static float sim_uniform(float, float);
+static float sim_normal(float);
+static void sim_output(std::string *);
+static bool sim_parse(const std::string &, sim_result_t *);
+static int32_t sim_number(const std::string &, const char *);
+
+/************************************************************************/
+/* Runs the firmware through its main loop in the arena of a scenario   */
+/* (@param scenario) and fills in @param result. The KPI report is      */
+/* stored in @param report and all serial output in @param log (0 for   */
+/* none). @returns false when the firmware made no KPI report.          */
+/************************************************************************/
+bool sim_run(const sim_scenario_t *scenario, sim_result_t *result, std::string *report, std::string *log)
+{
+    sim = sim_world_t();
+    sim.scenario = scenario;
+    sim.random.seed(scenario->seed);
+    sim.x = -NAV_START_DISTANCE + scenario->start_x;
+    sim.y = scenario->start_y;
+    sim.heading = scenario->start_heading;
+
+    sim_place_balls();
+
+    host_begin(sim_ping, sim_heading);
+
+    /// Boots like the robot, the run starts after the startup states.
+    setup();
+    sim_output(log);
+
+    uint64_t end = host_time() + scenario->run_ms * 1000ULL;
+
+    while (host_time() < end) {
+        loop();
+        sim_move();
+        sim_output(log);
+    }
+
+    kpi_report();
+
+    std::string output = host_serial_take();
+
+    if (log != 0) {
+        *log += output;
+    }
+
+    if (report != 0) {
+        *report = output;
+    }
+
+    result->collisions = sim.collisions;
+    result->launched = sim.launched;
+
+    return sim_parse(output, result);
+}
+
+/************************************************************************/
+/* Help function to place the balls of the scenario in the arena, clear */
+/* of the walls, of each other and of the robot.                        */
+/************************************************************************/
+static void sim_place_balls(void)
+{
+    float margin = SIM_BALL_RADIUS + 1;
+    float heap_x = sim_uniform(-SIM_ARENA_LENGTH + 40, -40);
+    float heap_y = sim_uniform(-SIM_ARENA_WIDTH / 2 + 40, SIM_ARENA_WIDTH / 2 - 40);
+
+    for (uint16_t tries = 0; (sim.balls.size() < sim.scenario->balls) && (tries < 10000); tries++) {
+        sim_ball_t ball;
+
+        switch (sim.scenario->layout) {
+            case SIM_BALLS_CLUSTERED :
+                ball.x = heap_x + sim_normal(15);
+                ball.y = heap_y + sim_normal(15);
+                break;
+            /// On a random wall, a few cm off it.
+            case SIM_BALLS_WALLS :
+                ball.x = sim_uniform(-SIM_ARENA_LENGTH + margin, -margin);
+                ball.y = sim_uniform(-SIM_ARENA_WIDTH / 2 + margin, SIM_ARENA_WIDTH / 2 - margin);
+
+                switch (sim.random() % 4) {
+                    case 0 : ball.x = -SIM_ARENA_LENGTH + margin + sim_uniform(0, 5); break;
+                    case 1 : ball.x = -margin - sim_uniform(0, 5);                    break;
+                    case 2 : ball.y = -SIM_ARENA_WIDTH / 2 + margin + sim_uniform(0, 5); break;
+                    case 3 : ball.y = SIM_ARENA_WIDTH / 2 - margin - sim_uniform(0, 5);  break;
+                }
+                break;
+            default :
+                ball.x = sim_uniform(-SIM_ARENA_LENGTH + margin, -margin);
+                ball.y = sim_uniform(-SIM_ARENA_WIDTH / 2 + margin, SIM_ARENA_WIDTH / 2 - margin);
+                break;
+        }
+
+        if (sim_ball_free(ball.x, ball.y)) {
+            sim.balls.push_back(ball);
+        }
+    }
+}
+
+/************************************************************************/
+/* Help function that @returns whether a ball fits at @param x,         */
+/* @param y or not.                                                     */
+/************************************************************************/
+static bool sim_ball_free(float x, float y)
+{
+    float margin = SIM_BALL_RADIUS + 1;
+
+    if ((x < -SIM_ARENA_LENGTH + margin) || (x > -margin) || (fabsf(y) > SIM_ARENA_WIDTH / 2 - margin)) {
+        return false;
+    }
+
+    if (hypotf(x - sim.x, y - sim.y) < SIM_ROBOT_RADIUS + 2 * SIM_BALL_RADIUS) {
+        return false;
+    }
+
+    for (size_t i = 0; i < sim.balls.size(); i++) {
+        if (hypotf(x - sim.balls[i].x, y - sim.balls[i].y) < 2 * SIM_BALL_RADIUS) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/************************************************************************/
+/* Help function that @returns the echo (cm, 0 for none) of the sonar   */
+/* with a trigger pin (@param trig) within @param max cm.               */
+/************************************************************************/
+static unsigned long sim_ping(uint8_t trig, unsigned int max_cm)
+{
+    sim_move();
+
+    float angle = radians(sim.heading);
+    float x = sim.x + SIM_ROBOT_RADIUS * cosf(angle);
+    float y = sim.y + SIM_ROBOT_RADIUS * sinf(angle);
+    float echo;
+
+    if (trig == SIM_BUCKET_TRIG_PIN) {
+        /// A held ball sits right in front of the sensor.
+        if (sim.bucket_ball && (sim.bucket_angle >= SIM_BUCKET_IN_ANGLE)) {
+            echo = SIM_HELD_DISTANCE;
+        } else {
+            echo = min(sim_wall_echo(x, y, angle, SIM_BUCKET_BEAM), sim_ball_echo(x, y, angle, SIM_BUCKET_BEAM));
+        }
+    } else if (trig == SIM_TOP_TRIG_PIN) {
+        angle -= radians(sim_servo_angle(OCR5C) - SIM_TOP_MID_ANGLE);
+
+        echo = sim_wall_echo(x, y, angle, SIM_TOP_BEAM);
+    } else {
+        return 0;
+    }
+
+    /// Lost and false echoes, and the noise of the rest.
+    if (sim_uniform(0, 1) < sim.scenario->sonar_dropout) {
+        return 0;
+    }
+
+    if (sim_uniform(0, 1) < sim.scenario->sonar_ghost) {
+        echo = sim_uniform(1, max_cm);
+    } else if (echo != INFINITY) {
+        echo += sim_normal(sim.scenario->sonar_noise);
+    }
+
+    return ((echo >= 0.5f) && (echo <= max_cm)) ? (unsigned long) lroundf(echo) : 0;
+}
+
+/************************************************************************/
+/* Help function that @returns the heading read by the compass          */
+/* (0-3599, tenths of degrees from north).                              */
+/************************************************************************/
+static uint16_t sim_heading(void)
+{
+    sim_move();
+
+    float field = sinf(2 * PI * sim.x / SIM_DISTURBANCE_PERIOD) * cosf(2 * PI * sim.y / SIM_DISTURBANCE_PERIOD);
+    float heading = sim.scenario->compass_north + sim.heading + sim.scenario->compass_disturbance * field +
+        sim_normal(sim.scenario->compass_noise);
+
+    long tenths = lroundf(heading * 10) % 3600;
+
+    return (uint16_t) ((tenths < 0) ? (tenths + 3600) : tenths);
+}
+
+/************************************************************************/
+/* Help function to move the world up to the time of the hardware.      */
+/************************************************************************/
+static void sim_move(void)
+{
+    while (host_time() >= sim.time + 1000) {
+        sim.time += 1000;
+
+        sim_step();
+    }
+}
+
+/************************************************************************/
+/* Help function to move the world by one step of 1 ms.                 */
+/************************************************************************/
+static void sim_step(void)
+{
+    float dt = 0.001f;
+
+    /// Right wheel on channel A, left wheel on channel B (wheel.cpp).
+    float target[2] = {
+        sim_wheel_target(9, 12, 10),
+        sim_wheel_target(8, 13, 11) * sim.scenario->wheel_ratio
+    };
+
+    for (uint8_t i = 0; i < 2; i++) {
+        float change = constrain(target[i] - sim.wheel[i], -SIM_ACCELERATION * dt, SIM_ACCELERATION * dt);
+
+        sim.wheel[i] += change;
+    }
+
+    sim_drive(dt);
+    sim_push_balls();
+    sim_servos();
+}
+
+/************************************************************************/
+/* Help function that @returns the target speed (cm/s, forward > 0) of  */
+/* the wheel on a channel of the motor shield (@param brake,            */
+/* @param direction and @param pwm pins).                               */
+/************************************************************************/
+static float sim_wheel_target(uint8_t brake, uint8_t direction, uint8_t pwm)
+{
+    if (host_pin(brake) == HIGH) {
+        return 0;
+    }
+
+    float speed = SIM_SPEED_LOW + (host_pwm(pwm) - SIM_PWM_LOW) * (SIM_SPEED_HIGH - SIM_SPEED_LOW) / (SIM_PWM_HIGH - SIM_PWM_LOW);
+
+    speed = max(speed, 0.0f);
+
+    return (host_pin(direction) == HIGH) ? speed : -speed;
+}
+
+/************************************************************************/
+/* Help function to move the robot for @param dt seconds. The walls     */
+/* stop it, a new contact is a collision.                               */
+/************************************************************************/
+static void sim_drive(float dt)
+{
+    float speed = (sim.wheel[0] + sim.wheel[1]) / 2;
+
+    /// The left wheel forward turns the robot clockwise.
+    sim.heading += degrees((sim.wheel[1] - sim.wheel[0]) / SIM_TRACK) * dt;
+    sim.heading = fmodf(sim.heading + 540, 360) - 180;
+
+    sim.x += speed * cosf(radians(sim.heading)) * dt;
+    sim.y += speed * sinf(radians(sim.heading)) * dt;
+
+    float x = constrain(sim.x, -SIM_ARENA_LENGTH + SIM_ROBOT_RADIUS, -SIM_ROBOT_RADIUS);
+    float y = constrain(sim.y, -SIM_ARENA_WIDTH / 2 + SIM_ROBOT_RADIUS, SIM_ARENA_WIDTH / 2 - SIM_ROBOT_RADIUS);
+
+    if ((x != sim.x) || (y != sim.y)) {
+        if (!sim.contact && (sim.time >= sim.free_time + SIM_CONTACT_CLEAR_TIME * 1000ULL)) {
+            sim.collisions++;
+        }
+
+        sim.contact = true;
+        sim.x = x;
+        sim.y = y;
+    } else if (sim.contact) {
+        sim.contact = false;
+        sim.free_time = sim.time;
+    }
+}
+
+/************************************************************************/
+/* Help function to push the balls the body runs into out of its way.   */
+/************************************************************************/
+static void sim_push_balls(void)
+{
+    float reach = SIM_ROBOT_RADIUS + SIM_BALL_RADIUS;
+
+    for (size_t i = 0; i < sim.balls.size(); i++) {
+        sim_ball_t *ball = &sim.balls[i];
+        float dx = ball->x - sim.x;
+        float dy = ball->y - sim.y;
+        float distance = hypotf(dx, dy);
+
+        if ((distance < reach) && (distance > 0)) {
+            ball->x = constrain(sim.x + dx * reach / distance, -SIM_ARENA_LENGTH + SIM_BALL_RADIUS, -SIM_BALL_RADIUS);
+            ball->y = constrain(sim.y + dy * reach / distance, -SIM_ARENA_WIDTH / 2 + SIM_BALL_RADIUS, SIM_ARENA_WIDTH / 2 - SIM_BALL_RADIUS);
+        }
+    }
+}
+
+/************************************************************************/
+/* Help function to move the balls with the servos: the bucket scoops   */
+/* up a ball within its reach, the lifting arm tips it into the empty   */
+/* catapult, and the catapult throws it when the lock lets go of the    */
+/* tightened arm.                                                       */
+/************************************************************************/
+static void sim_servos(void)
+{
+    int16_t bucket = sim_servo_angle(OCR5B);
+    int16_t lock = sim_servo_angle(OCR5A);
+
+    /// The bucket moves in.
+    if ((bucket >= SIM_BUCKET_IN_ANGLE) && (sim.bucket_angle < SIM_BUCKET_IN_ANGLE) && !sim.bucket_ball) {
+        for (size_t i = 0; i < sim.balls.size(); i++) {
+            float dx = sim.balls[i].x - sim.x;
+            float dy = sim.balls[i].y - sim.y;
+            float bearing = degrees(atan2f(dy, dx)) - sim.heading;
+
+            bearing = fmodf(bearing + 540, 360) - 180;
+
+            if ((hypotf(dx, dy) <= SIM_ROBOT_RADIUS + SIM_BALL_RADIUS + SIM_CATCH_REACH) && (fabsf(bearing) <= SIM_CATCH_ANGLE)) {
+                sim.balls.erase(sim.balls.begin() + i);
+                sim.bucket_ball = true;
+                break;
+            }
+        }
+
+    /// The bucket moves out - a ball still in it falls out in front.
+    } else if ((bucket < SIM_BUCKET_IN_ANGLE) && (sim.bucket_angle >= SIM_BUCKET_IN_ANGLE) && sim.bucket_ball) {
+        sim_ball_t ball;
+        float reach = SIM_ROBOT_RADIUS + SIM_BALL_RADIUS + 1;
+
+        ball.x = sim.x + reach * cosf(radians(sim.heading));
+        ball.y = sim.y + reach * sinf(radians(sim.heading));
+
+        sim.balls.push_back(ball);
+        sim.bucket_ball = false;
+    }
+
+    if (sim.bucket_ball && !sim.catapult_ball && (bucket >= SIM_BUCKET_IN_ANGLE) && (sim_servo_angle(OCR3A) >= SIM_ARM_UP_ANGLE)) {
+        sim.bucket_ball = false;
+        sim.catapult_ball = true;
+    }
+
+    if ((lock < SIM_UNLOCKED_ANGLE) && (sim.lock_angle >= SIM_UNLOCKED_ANGLE) && (sim_servo_angle(OCR3B) >= SIM_CATAPULT_UP_ANGLE) && sim.catapult_ball) {
+        sim.catapult_ball = false;
+        sim.launched++;
+    }
+
+    sim.bucket_angle = bucket;
+    sim.lock_angle = lock;
+}
+
+/************************************************************************/
+/* Help function that @returns the angle (degrees) of a servo from its  */
+/* output compare register (@param ocr).                                */
+/************************************************************************/
+static int16_t sim_servo_angle(uint16_t ocr)
+{
+    int32_t pulse = ocr / SIM_SERVO_COUNTS_PER_US;
+
+    return (int16_t) (((pulse - SIM_SERVO_MIN_PULSE) * 180 + (SIM_SERVO_MAX_PULSE - SIM_SERVO_MIN_PULSE) / 2) / (SIM_SERVO_MAX_PULSE - SIM_SERVO_MIN_PULSE));
+}
+
+/************************************************************************/
+/* Help function that @returns the distance (cm, INFINITY for none) of  */
+/* the nearest wall echo of a sonar at @param x, @param y pointing in   */
+/* @param angle (radians) with a beam of @param beam degrees.           */
+/************************************************************************/
+static float sim_wall_echo(float x, float y, float angle, float beam)
+{
+    /// Distance to each wall and the direction of the wall (radians).
+    const float wall[4][2] = {
+        {-x,                          0},
+        {x + SIM_ARENA_LENGTH,        PI},
+        {SIM_ARENA_WIDTH / 2 - y,     PI / 2},
+        {y + SIM_ARENA_WIDTH / 2,     -PI / 2}
+    };
+
+    float echo = INFINITY;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        float off = fabsf(degrees(remainderf(angle - wall[i][1], 2 * PI)));
+
+        /// Angle between the edge of the beam and the wall normal.
+        off = max(off - beam, 0.0f);
+
+        if (off >= SIM_SPECULAR_LIMIT) {
+            continue;
+        }
+
+        /// The sound is reflected away from the sensor now and then.
+        if ((off > SIM_SPECULAR_START) && (sim_uniform(SIM_SPECULAR_START, SIM_SPECULAR_LIMIT) < off)) {
+            continue;
+        }
+
+        echo = min(echo, max(wall[i][0], 0.0f) / cosf(radians(off)));
+    }
+
+    return echo;
+}
+
+/************************************************************************/
+/* Help function that @returns the distance (cm, INFINITY for none) of  */
+/* the nearest ball in the beam of @param beam degrees of a sonar at    */
+/* @param x, @param y pointing in @param angle (radians).               */
+/************************************************************************/
+static float sim_ball_echo(float x, float y, float angle, float beam)
+{
+    float echo = INFINITY;
+
+    for (size_t i = 0; i < sim.balls.size(); i++) {
+        float dx = sim.balls[i].x - x;
+        float dy = sim.balls[i].y - y;
+        float distance = hypotf(dx, dy);
+
+        if (distance <= SIM_BALL_RADIUS) {
+            continue;
+        }
+
+        float off = fabsf(degrees(remainderf(atan2f(dy, dx) - angle, 2 * PI)));
+
+        if (off <= beam + degrees(asinf(SIM_BALL_RADIUS / distance))) {
+            echo = min(echo, distance - SIM_BALL_RADIUS);
+        }
+    }
+
+    return echo;
+}
+
+/************************************************************************/
+/* Help function that @returns a random number from @param low up to    */
+/* @param high.                                                         */
+/************************************************************************/
+static float sim_uniform(float low, float high)
+{
+    return std::uniform_real_distribution<float>(low, high)(sim.random);
+}
+
+/************************************************************************/
+/* Help function that @returns a normally distributed random number     */
+/* around 0 with a standard deviation of @param sigma.                  */
+/************************************************************************/
+static float sim_normal(float sigma)
+{
+    return (sigma > 0) ? std::normal_distribution<float>(0, sigma)(sim.random) : 0;
+}
+
+/************************************************************************/
+/* Help function to append the serial output to @param log, if any.     */
+/************************************************************************/
+static void sim_output(std::string *log)
+{
+    std::string output = host_serial_take();
+
+    if (log != 0) {
+        *log += output;
+    }
+}
+
+/************************************************************************/
+/* Help function to read the KPI report (@param report, kpi_report())   */
+/* into @param result. @returns false when it is not complete.          */
+/************************************************************************/
+static bool sim_parse(const std::string &report, sim_result_t *result)
+{
+    result->run_ms           = sim_number(report, "run_ms");
+    result->first_launch_ms  = sim_number(report, "first_launch_ms");
+    result->balls_caught     = sim_number(report, "balls_caught");
+    result->launches         = sim_number(report, "launches");
+    result->launch_rate      = sim_number(report, "launches_per_min_x10");
+    result->wall_turns       = sim_number(report, "wall_turns");
+    result->wall_turn_rate   = sim_number(report, "wall_turns_per_min_x10");
+    result->compass_timeouts = sim_number(report, "compass_timeouts");
+    result->budget_overruns  = sim_number(report, "budget_overruns");
+    result->pass = (report.find("\"pass\":true") != std::string::npos);
+
+    return (result->run_ms >= 0) && (report.find("\"pass\":") != std::string::npos);
+}
+
+/************************************************************************/
+/* Help function that @returns the first number of a key (@param key)   */
+/* in the KPI report (@param report), or -1 when it is missing.         */
+/************************************************************************/
+static int32_t sim_number(const std::string &report, const char *key)
+{
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t at = report.find(pattern);
+
+    return (at != std::string::npos) ? (int32_t) strtol(report.c_str() + at + pattern.size(), 0, 10) : -1;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+/************************************************************************/
+/* sim.h - The .h file for the simulated arena of the host build.       */
+/*                                                                      */
+/* Runs the unchanged firmware through its main loop against a          */
+/* simulated half of the arena: the robot drives on the motor shield    */
+/* outputs, the sonars see walls and balls, the compass reads the       */
+/* heading, and the servos pick up and launch the balls.                */
+/*                                                                      */
+/* Not included by the firmware - keep the Arduino macros out of here.  */
+/************************************************************************/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <string>
+
+/// Ball layouts.
+#define SIM_BALLS_SCATTERED  0   // anywhere in the arena
+#define SIM_BALLS_CLUSTERED  1   // in a heap in the arena
+#define SIM_BALLS_WALLS      2   // along the walls
+
+/// Description of one run: arena, start pose, disturbances and the length of the run.
+typedef struct {
+    const char *name;
+
+    /// Seed of the ball layout and of all the noise.
+    uint32_t seed;
+
+    /// Number of balls and their layout.
+    uint8_t balls;
+    uint8_t layout;
+
+    /// Start position error (cm, along and across the start heading) and start heading
+    /// error (degrees, clockwise > 0) against the start pose the firmware assumes.
+    float start_x;
+    float start_y;
+    float start_heading;
+
+    /// Compass: heading of the mid wall (degrees from north), amplitude of the local
+    /// disturbance of the field (degrees) and the noise of a sample (degrees).
+    float compass_north;
+    float compass_disturbance;
+    float compass_noise;
+
+    /// Sonars: noise of an echo (cm), probability of a lost echo and of a false one.
+    float sonar_noise;
+    float sonar_dropout;
+    float sonar_ghost;
+
+    /// Speed of the left wheel against the right one (1 for equal wheels).
+    float wheel_ratio;
+
+    /// Length of the run after the startup states (ms).
+    uint32_t run_ms;
+} sim_scenario_t;
+
+/// Outcome of one run: the key performance numbers reported by the firmware (kpi.cpp)
+/// and what happened in the arena.
+typedef struct {
+    /// Key performance numbers, -1 for a missing first launch.
+    int32_t run_ms;
+    int32_t first_launch_ms;
+    int32_t balls_caught;
+    int32_t launches;
+    int32_t launch_rate;
+    int32_t wall_turns;
+    int32_t wall_turn_rate;
+    int32_t compass_timeouts;
+    int32_t budget_overruns;
+
+    /// All baselines of config.h met or not.
+    bool pass;
+
+    /// Wall collisions and balls the catapult really threw (the firmware counts empty
+    /// launches too).
+    uint16_t collisions;
+    uint16_t launched;
+} sim_result_t;
+
+/************************************************************************/
+/* Declaration of functions used in sim.cpp (needed elsewhere).         */
+/************************************************************************/
+bool sim_run(const sim_scenario_t *, sim_result_t *, std::string *, std::string *);
+
+#endif
\ No newline at end of file
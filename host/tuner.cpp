@@ -0,0 +1,388 @@
+/************************************************************************/
+/* tuner.cpp - The .cpp file for the Monte Carlo parameter tuner.       */
+/*                                                                      */
+/* Runs the firmware through randomized matches in the simulated arena  */
+/* (sim.cpp) - ball layouts, start poses, compass disturbance, sonar    */
+/* noise and wheel mismatch drawn from the seed - and tunes the state   */
+/* delays, the sensor trigger distances and the wheel speeds for the    */
+/* most balls launched per minute. Every parameter set plays the same   */
+/* matches, side by side on all cores, so two sets differ only in their */
+/* parameters. The search steps one parameter at a time from the        */
+/* firmware configuration and keeps a step when the set launches more   */
+/* balls without hitting the walls more often. The sensitivity of the   */
+/* result to each parameter is reported, and the tuned set is written   */
+/* in the format of tuning.h.                                           */
+/*                                                                      */
+/* Usage: robot_tuner [-n <matches>] [-r <rounds>] [-m <ms>]            */
+/*                    [-s <seed>] [-o <file>]                           */
+/*   -n <matches>  matches per parameter set (1000)                     */
+/*   -r <rounds>   rounds of steps over all parameters (3)              */
+/*   -m <ms>       length of a match after the startup states (120000)  */
+/*   -s <seed>     seed of the matches (1)                              */
+/*   -o <file>     writes the tuned set to a file instead of stdout,    */
+/*                 to be placed as tuning.h next to config.h            */
+/************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "sim.h"
+#include "tuner.h"
+#include "config.h"
+
+/// A parameter the tuner varies: its value in the firmware configuration and the
+/// values it may take (min to max in steps).
+typedef struct {
+    const char *name;
+    int16_t value;
+    int16_t min;
+    int16_t max;
+    int16_t step;
+} tuner_parameter_t;
+
+#define TUNER_PARAMETER(name, min, max, step)  {#name, name, min, max, step}
+
+/// The parameters, in the order of tuner.h. The low wheel speeds stay below the high
+/// ones, a PWM duty cycle below 80 hardly moves the robot.
+static const tuner_parameter_t tuner_parameters[TUNER_PARAMETER_COUNT] = {
+    TUNER_PARAMETER(GO_BACK_DELAY_TIME,                250,  2000,  250),
+    TUNER_PARAMETER(MAKE_TURN_DELAY_TIME,              250,  3000,  250),
+    TUNER_PARAMETER(TURN_TO_MID_WALL_DELAY,            2000, 15000, 1000),
+    TUNER_PARAMETER(BACK_AWAY_TRIG_COUNT,              1,    8,     1),
+    TUNER_PARAMETER(BUCKET_SENSOR_TRIGGER_DISTANCE,    6,    18,    1),
+    TUNER_PARAMETER(TOP_SENSOR_TRIGGER_DISTANCE_MID,   10,   40,    2),
+    TUNER_PARAMETER(TOP_SENSOR_TRIGGER_DISTANCE_SIDE,  10,   40,    2),
+    TUNER_PARAMETER(WHEEL_SPEED_RIGHT_HIGH,            120,  200,   10),
+    TUNER_PARAMETER(WHEEL_SPEED_LEFT_HIGH,             120,  200,   10),
+    TUNER_PARAMETER(WHEEL_SPEED_RIGHT_LOW,             80,   115,   5),
+    TUNER_PARAMETER(WHEEL_SPEED_LEFT_LOW,              80,   115,   5)
+};
+
+/// Values of the parameters in the match of the calling thread (read by the firmware).
+thread_local int16_t tuner_values[TUNER_PARAMETER_COUNT];
+
+/// A parameter set and how it did in the matches.
+typedef struct {
+    int16_t values[TUNER_PARAMETER_COUNT];
+
+    /// Balls launched per minute in each match, their mean and the mean wall collisions
+    /// per match.
+    std::vector<float> rates;
+    float rate;
+    float collisions;
+
+    /// Matches without a KPI report (counted as no ball launched).
+    uint32_t failed;
+} tuner_set_t;
+
+/// Outcome of one match.
+typedef struct {
+    bool complete;
+    sim_result_t result;
+} tuner_outcome_t;
+
+/// Pre-declaration of help functions.
+static void tuner_evaluate(tuner_set_t *, const std::vector<sim_scenario_t> *);
+static void tuner_worker(const tuner_set_t *, const std::vector<sim_scenario_t> *, std::vector<tuner_outcome_t> *, std::atomic<size_t> *);
+static void tuner_match(const tuner_set_t *, const sim_scenario_t *, tuner_outcome_t *);
+static sim_scenario_t tuner_scenario(uint32_t, uint32_t);
+static bool tuner_step(const tuner_set_t *, uint8_t, int8_t, tuner_set_t *);
+static void tuner_sensitivity(const tuner_set_t *, const std::vector<sim_scenario_t> *);
+static bool tuner_write(const tuner_set_t *, const tuner_set_t *, const char *, uint32_t, uint32_t, uint32_t);
+
+/************************************************************************/
+/* Tunes the parameters. @returns 0 when the tuned set is written and 2 */
+/* on errors.                                                           */
+/************************************************************************/
+int main(int argc, char **argv)
+{
+    uint32_t matches = 1000;
+    uint32_t rounds = 3;
+    uint32_t run_ms = 120000;
+    uint32_t seed = 1;
+    const char *output = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+            matches = strtoul(argv[++i], 0, 10);
+        } else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+            rounds = strtoul(argv[++i], 0, 10);
+        } else if ((strcmp(argv[i], "-m") == 0) && (i + 1 < argc)) {
+            run_ms = strtoul(argv[++i], 0, 10);
+        } else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc)) {
+            seed = strtoul(argv[++i], 0, 10);
+        } else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc)) {
+            output = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [-n <matches>] [-r <rounds>] [-m <ms>] [-s <seed>] [-o <file>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if ((matches == 0) || (run_ms == 0)) {
+        fprintf(stderr, "Needs at least one match of at least 1 ms\n");
+        return 2;
+    }
+
+    /// Every parameter set plays the same matches.
+    std::vector<sim_scenario_t> scenarios;
+
+    for (uint32_t i = 0; i < matches; i++) {
+        scenarios.push_back(tuner_scenario(seed + i, run_ms));
+    }
+
+    tuner_set_t start;
+
+    for (uint8_t i = 0; i < TUNER_PARAMETER_COUNT; i++) {
+        start.values[i] = tuner_parameters[i].value;
+    }
+
+    tuner_evaluate(&start, &scenarios);
+
+    printf("firmware: %.2f balls/min, %.2f collisions/match, %u of %u matches without report\n",
+        start.rate, start.collisions, start.failed, matches);
+
+    /// Steps one parameter at a time, until a round over all of them finds no better set.
+    tuner_set_t best = start;
+
+    for (uint32_t round = 1; round <= rounds; round++) {
+        bool improved = false;
+
+        for (uint8_t i = 0; i < TUNER_PARAMETER_COUNT; i++) {
+            for (int8_t direction = -1; direction <= 1; direction += 2) {
+                tuner_set_t candidate;
+
+                if (!tuner_step(&best, i, direction, &candidate)) {
+                    continue;
+                }
+
+                tuner_evaluate(&candidate, &scenarios);
+
+                /// Launching more balls must not take more wall collisions.
+                if ((candidate.rate > best.rate) && (candidate.collisions <= start.collisions)) {
+                    printf("round %u: %s %d -> %d: %.2f balls/min, %.2f collisions/match\n", round,
+                        tuner_parameters[i].name, best.values[i], candidate.values[i], candidate.rate, candidate.collisions);
+
+                    best = candidate;
+                    improved = true;
+                }
+            }
+        }
+
+        if (!improved) {
+            break;
+        }
+    }
+
+    printf("tuned: %.2f balls/min, %.2f collisions/match, %u of %u matches without report\n\n",
+        best.rate, best.collisions, best.failed, matches);
+
+    tuner_sensitivity(&best, &scenarios);
+
+    if (!tuner_write(&start, &best, output, matches, run_ms, seed)) {
+        fprintf(stderr, "Can't write %s\n", output);
+        return 2;
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/* Help function to play all matches (@param scenarios) with the values */
+/* of a parameter set (@param set) and to store how it did.             */
+/************************************************************************/
+static void tuner_evaluate(tuner_set_t *set, const std::vector<sim_scenario_t> *scenarios)
+{
+    std::vector<tuner_outcome_t> outcomes(scenarios->size());
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next(0);
+    unsigned cores = std::thread::hardware_concurrency();
+
+    for (unsigned i = 0; (i < scenarios->size()) && (i < ((cores != 0) ? cores : 1)); i++) {
+        workers.push_back(std::thread(tuner_worker, set, scenarios, &outcomes, &next));
+    }
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    set->rates.clear();
+    set->rate = 0;
+    set->collisions = 0;
+    set->failed = 0;
+
+    for (size_t i = 0; i < outcomes.size(); i++) {
+        float rate = 0;
+
+        if (outcomes[i].complete) {
+            rate = outcomes[i].result.launched * 60000.0f / (*scenarios)[i].run_ms;
+        } else {
+            set->failed++;
+        }
+
+        set->rates.push_back(rate);
+        set->rate += rate / outcomes.size();
+        set->collisions += (float) outcomes[i].result.collisions / outcomes.size();
+    }
+}
+
+/************************************************************************/
+/* Help function to play matches (@param scenarios) with a parameter    */
+/* set (@param set) until none is left, taking the next one from        */
+/* @param next, into @param outcomes.                                   */
+/************************************************************************/
+static void tuner_worker(const tuner_set_t *set, const std::vector<sim_scenario_t> *scenarios, std::vector<tuner_outcome_t> *outcomes, std::atomic<size_t> *next)
+{
+    for (size_t i = (*next)++; i < scenarios->size(); i = (*next)++) {
+        /// A thread per match: the firmware tables holding the parameters (RUN_LOCAL) are
+        /// set up when a thread first uses them.
+        std::thread match(tuner_match, set, &(*scenarios)[i], &(*outcomes)[i]);
+
+        match.join();
+    }
+}
+
+/************************************************************************/
+/* Help function to play one match (@param scenario) with the values of */
+/* a parameter set (@param set), into @param outcome.                   */
+/************************************************************************/
+static void tuner_match(const tuner_set_t *set, const sim_scenario_t *scenario, tuner_outcome_t *outcome)
+{
+    memcpy(tuner_values, set->values, sizeof(tuner_values));
+
+    outcome->result = sim_result_t();
+    outcome->complete = sim_run(scenario, &outcome->result, 0, 0);
+}
+
+/************************************************************************/
+/* Help function that @returns a randomized match of a length           */
+/* (@param run_ms) drawn from a seed (@param seed). The ranges cover    */
+/* the arenas of the scenario library (scenarios.cpp).                  */
+/************************************************************************/
+static sim_scenario_t tuner_scenario(uint32_t seed, uint32_t run_ms)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(0, 1);
+    sim_scenario_t scenario;
+
+    scenario.name = "match";
+    scenario.seed = random();
+    scenario.balls = 6 + random() % 5;
+    scenario.layout = random() % 3;
+    scenario.start_x = -10 + 20 * unit(random);
+    scenario.start_y = -30 + 60 * unit(random);
+    scenario.start_heading = -8 + 16 * unit(random);
+    scenario.compass_north = 360 * unit(random);
+    scenario.compass_disturbance = 15 * unit(random);
+    scenario.compass_noise = unit(random);
+    scenario.sonar_noise = 2 * unit(random);
+    scenario.sonar_dropout = 0.2f * unit(random);
+    scenario.sonar_ghost = 0.03f * unit(random);
+    scenario.wheel_ratio = 0.95f + 0.1f * unit(random);
+    scenario.run_ms = run_ms;
+
+    return scenario;
+}
+
+/************************************************************************/
+/* Help function to step one parameter (@param parameter) of a set      */
+/* (@param set) in a direction (@param direction, -1 or 1) into         */
+/* @param stepped. @returns false when the step leaves the range.       */
+/************************************************************************/
+static bool tuner_step(const tuner_set_t *set, uint8_t parameter, int8_t direction, tuner_set_t *stepped)
+{
+    const tuner_parameter_t *p = &tuner_parameters[parameter];
+    int16_t value = set->values[parameter] + direction * p->step;
+
+    if ((value < p->min) || (value > p->max)) {
+        return false;
+    }
+
+    memcpy(stepped->values, set->values, sizeof(stepped->values));
+    stepped->values[parameter] = value;
+
+    return true;
+}
+
+/************************************************************************/
+/* Help function to print the sensitivity of the balls launched per     */
+/* minute to each parameter, one step either side of the tuned set      */
+/* (@param tuned), played in the matches (@param scenarios). The change */
+/* per step is the mean over the matches (paired, so the layouts and    */
+/* the noise cancel out) with its standard error.                       */
+/************************************************************************/
+static void tuner_sensitivity(const tuner_set_t *tuned, const std::vector<sim_scenario_t> *scenarios)
+{
+    printf("%-33s %8s %7s %11s %7s %7s %7s %15s\n", "parameter", "firmware", "tuned", "range",
+        "-step", "tuned", "+step", "per step");
+
+    for (uint8_t i = 0; i < TUNER_PARAMETER_COUNT; i++) {
+        const tuner_parameter_t *p = &tuner_parameters[i];
+        tuner_set_t lower = *tuned;
+        tuner_set_t upper = *tuned;
+        uint8_t steps = 0;
+
+        if (tuner_step(tuned, i, -1, &lower)) {
+            tuner_evaluate(&lower, scenarios);
+            steps++;
+        }
+
+        if (tuner_step(tuned, i, 1, &upper)) {
+            tuner_evaluate(&upper, scenarios);
+            steps++;
+        }
+
+        /// Paired differences between one step above and one below (or the tuned set).
+        double sum = 0;
+        double squares = 0;
+        size_t n = tuned->rates.size();
+
+        for (size_t m = 0; (steps != 0) && (m < n); m++) {
+            double d = (upper.rates[m] - lower.rates[m]) / steps;
+
+            sum += d;
+            squares += d * d;
+        }
+
+        double mean = sum / n;
+        double error = (n > 1) ? sqrt(fmax(squares / n - mean * mean, 0) / (n - 1)) : 0;
+        char range[16];
+
+        snprintf(range, sizeof(range), "%d-%d", p->min, p->max);
+
+        printf("%-33s %8d %7d %11s %7.2f %7.2f %7.2f %+7.2f +-%5.2f\n", p->name, p->value, tuned->values[i], range,
+            lower.rate, tuned->rate, upper.rate, mean, error);
+    }
+
+    printf("\n");
+}
+
+/************************************************************************/
+/* Help function to write the tuned set (@param tuned) in the format of */
+/* tuning.h to a file (@param output, stdout for none), with how it did */
+/* against the firmware configuration (@param start) in the matches     */
+/* (@param matches of @param run_ms from @param seed).                  */
+/* @returns whether the file was written or not.                        */
+/************************************************************************/
+static bool tuner_write(const tuner_set_t *start, const tuner_set_t *tuned, const char *output, uint32_t matches, uint32_t run_ms, uint32_t seed)
+{
+    FILE *file = (output != 0) ? fopen(output, "w") : stdout;
+
+    if (file == 0) {
+        return false;
+    }
+
+    fprintf(file, "/// Tuned by robot_tuner over %u matches of %u ms (seed %u):\n", matches, run_ms, seed);
+    fprintf(file, "/// %.2f balls launched per minute, %.2f with the firmware configuration.\n", tuned->rate, start->rate);
+
+    for (uint8_t i = 0; i < TUNER_PARAMETER_COUNT; i++) {
+        fprintf(file, "#define %s  %d\n", tuner_parameters[i].name, tuned->values[i]);
+    }
+
+    return (output != 0) ? (fclose(file) == 0) : true;
+}
\ No newline at end of file
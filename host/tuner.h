@@ -0,0 +1,70 @@
+/************************************************************************/
+/* tuner.h - The .h file for the parameters varied by the host tuner.   */
+/*                                                                      */
+/* The tuner (tuner.cpp) runs each match on a thread of its own with    */
+/* the values of one parameter set. The tuner build of the firmware     */
+/* (TUNER, included at the end of config.h) reads these parameters from */
+/* the values of its thread instead of config.h.                        */
+/************************************************************************/
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <stdint.h>
+
+/// Parameters the tuner varies, in the order of the parameter table in tuner.cpp.
+#define TUNER_GO_BACK_DELAY_TIME                0
+#define TUNER_MAKE_TURN_DELAY_TIME              1
+#define TUNER_TURN_TO_MID_WALL_DELAY            2
+#define TUNER_BACK_AWAY_TRIG_COUNT              3
+#define TUNER_BUCKET_SENSOR_TRIGGER_DISTANCE    4
+#define TUNER_TOP_SENSOR_TRIGGER_DISTANCE_MID   5
+#define TUNER_TOP_SENSOR_TRIGGER_DISTANCE_SIDE  6
+#define TUNER_WHEEL_SPEED_RIGHT_HIGH            7
+#define TUNER_WHEEL_SPEED_LEFT_HIGH             8
+#define TUNER_WHEEL_SPEED_RIGHT_LOW             9
+#define TUNER_WHEEL_SPEED_LEFT_LOW              10
+
+#define TUNER_PARAMETER_COUNT  11
+
+/// Values of the parameters in the match of the calling thread (tuner.cpp).
+extern thread_local int16_t tuner_values[TUNER_PARAMETER_COUNT];
+
+/// The tuner build reads the parameters from the values of its match. The tables holding
+/// them are RUN_LOCAL, so they are set up when the thread of a match first uses them.
+#ifdef TUNER
+#undef GO_BACK_DELAY_TIME
+#define GO_BACK_DELAY_TIME  (tuner_values[TUNER_GO_BACK_DELAY_TIME])
+
+#undef MAKE_TURN_DELAY_TIME
+#define MAKE_TURN_DELAY_TIME  (tuner_values[TUNER_MAKE_TURN_DELAY_TIME])
+
+#undef TURN_TO_MID_WALL_DELAY
+#define TURN_TO_MID_WALL_DELAY  (tuner_values[TUNER_TURN_TO_MID_WALL_DELAY])
+
+#undef BACK_AWAY_TRIG_COUNT
+#define BACK_AWAY_TRIG_COUNT  (tuner_values[TUNER_BACK_AWAY_TRIG_COUNT])
+
+#undef BUCKET_SENSOR_TRIGGER_DISTANCE
+#define BUCKET_SENSOR_TRIGGER_DISTANCE  (tuner_values[TUNER_BUCKET_SENSOR_TRIGGER_DISTANCE])
+
+#undef TOP_SENSOR_TRIGGER_DISTANCE_MID
+#define TOP_SENSOR_TRIGGER_DISTANCE_MID  (tuner_values[TUNER_TOP_SENSOR_TRIGGER_DISTANCE_MID])
+
+#undef TOP_SENSOR_TRIGGER_DISTANCE_SIDE
+#define TOP_SENSOR_TRIGGER_DISTANCE_SIDE  (tuner_values[TUNER_TOP_SENSOR_TRIGGER_DISTANCE_SIDE])
+
+#undef WHEEL_SPEED_RIGHT_HIGH
+#define WHEEL_SPEED_RIGHT_HIGH  (tuner_values[TUNER_WHEEL_SPEED_RIGHT_HIGH])
+
+#undef WHEEL_SPEED_LEFT_HIGH
+#define WHEEL_SPEED_LEFT_HIGH  (tuner_values[TUNER_WHEEL_SPEED_LEFT_HIGH])
+
+#undef WHEEL_SPEED_RIGHT_LOW
+#define WHEEL_SPEED_RIGHT_LOW  (tuner_values[TUNER_WHEEL_SPEED_RIGHT_LOW])
+
+#undef WHEEL_SPEED_LEFT_LOW
+#define WHEEL_SPEED_LEFT_LOW  (tuner_values[TUNER_WHEEL_SPEED_LEFT_LOW])
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,176 @@
+/************************************************************************/
+/* kpi.cpp - The .cpp file for the key performance numbers of a run.    */
+/*                                                                      */
+/* Counts the time per state and the events of a run in control ticks,  */
+/* and compares them with the baselines in config.h. Missed ticks are   */
+/* counted in the current state, so a stalled loop costs run time. The  */
+/* run starts when the startup states are done. A host replay runs no   */
+/* missed ticks, so its times can be shorter than on the robot.         */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "kpi.h"
+#include "config.h"
+#include "robot.h"
+#include "state.h"
+#include "timer.h"
+
+/// Memory of the key performance numbers for a run.
+typedef struct {
+    /// Ticks spent in each state (STATE_INDEX()).
+    uint32_t state_ticks[STATE_COUNT];
+    
+    /// Number of each event.
+    uint16_t events[KPI_EVENTS];
+    
+    /// Ticks since the start of the run and at the first launch (0 for none).
+    uint32_t run_ticks;
+    uint32_t first_launch;
+    
+    /// Variable saying if the run has started.
+    bool running;
+    
+    /// Missed ticks (timer.cpp) already counted.
+    uint16_t missed;
+} kpi_context_t;
+
+/// The key performance numbers of the robot.
+static RUN_LOCAL kpi_context_t kpi_context;
+
+/// Pre-declaration of help function.
+static bool kpi_check(const __FlashStringHelper *, uint32_t, uint32_t, bool, bool);
+
+/************************************************************************/
+/* Clears the numbers to the start of a run.                            */
+/************************************************************************/
+void kpi_clear(void)
+{
+    memset(&kpi_context, 0, sizeof(kpi_context_t));
+}
+
+/************************************************************************/
+/* Counts one tick and the ticks missed since the last one in the       */
+/* current state (@param state). Called from control_tick().            */
+/************************************************************************/
+void kpi_tick(int8_t state)
+{
+    uint16_t missed = timer_missed_ticks();
+    uint16_t ticks = 1 + (uint16_t) (missed - kpi_context.missed);
+    kpi_context.missed = missed;
+    
+    if ((state < LIFTING_ARM_HOME) || (state > COMPASS_CALIBRATION)) {
+        return;
+    }
+    
+    kpi_context.state_ticks[STATE_INDEX(state)] += ticks;
+    
+    /// The run starts with the first regular state.
+    if (state >= _DEFAULT) {
+        kpi_context.running = true;
+    }
+    
+    if (kpi_context.running) {
+        kpi_context.run_ticks += ticks;
+    }
+}
+
+/************************************************************************/
+/* Counts one event (@param event).                                     */
+/************************************************************************/
+void kpi_event(uint8_t event)
+{
+    if (kpi_context.events[event] < UINT16_MAX) {
+        kpi_context.events[event]++;
+    }
+    
+    if ((event == KPI_LAUNCHES) && (kpi_context.first_launch == 0)) {
+        kpi_context.first_launch = kpi_context.run_ticks;
+    }
+}
+
+/************************************************************************/
+/* Prints the numbers of the run and the comparison with the baselines  */
+/* over serial as JSON.                                                 */
+/************************************************************************/
+void kpi_report(void)
+{
+    uint32_t run_ms = TICKS_TO_MS(kpi_context.run_ticks);
+    uint32_t minutes_x10 = run_ms / 6000;
+    
+    /// Rates per minute, in tenths.
+    uint32_t launch_rate = (minutes_x10 != 0) ? ((uint32_t) kpi_context.events[KPI_LAUNCHES] * 100) / minutes_x10 : 0;
+    uint32_t wall_rate   = (minutes_x10 != 0) ? ((uint32_t) kpi_context.events[KPI_WALL_TURNS] * 100) / minutes_x10 : 0;
+    
+    Serial.print(F("{\"run_ms\":"));
+    Serial.print(run_ms);
+    Serial.print(F(",\"first_launch_ms\":"));
+    Serial.print((kpi_context.first_launch != 0) ? (int32_t) TICKS_TO_MS(kpi_context.first_launch) : -1L);
+    Serial.print(F(",\"balls_caught\":"));
+    Serial.print(kpi_context.events[KPI_BALLS_CAUGHT]);
+    Serial.print(F(",\"launches\":"));
+    Serial.print(kpi_context.events[KPI_LAUNCHES]);
+    Serial.print(F(",\"launches_per_min_x10\":"));
+    Serial.print(launch_rate);
+    Serial.print(F(",\"wall_turns\":"));
+    Serial.print(kpi_context.events[KPI_WALL_TURNS]);
+    Serial.print(F(",\"wall_turns_per_min_x10\":"));
+    Serial.print(wall_rate);
+    Serial.print(F(",\"compass_timeouts\":"));
+    Serial.print(kpi_context.events[KPI_COMPASS_TIMEOUTS]);
+    Serial.print(F(",\"budget_overruns\":"));
+    Serial.print(kpi_context.events[KPI_BUDGET_OVERRUNS]);
+    
+    Serial.println(F(",\"states\":["));
+    
+    for (uint8_t i = 0; i < STATE_COUNT; i++) {
+        if (i != 0) {
+            Serial.println(',');
+        }
+        
+        Serial.print(F("{\"name\":\""));
+        state_print_name(i + LIFTING_ARM_HOME);
+        Serial.print(F("\",\"ms\":"));
+        Serial.print(TICKS_TO_MS(kpi_context.state_ticks[i]));
+        Serial.print('}');
+    }
+    
+    Serial.println(F("\n],\"baseline\":{"));
+    
+    /// Every check is run so all of them are printed.
+    bool ok = true;
+    ok &= kpi_check(F("first_launch_ms"), (kpi_context.first_launch != 0) ? TICKS_TO_MS(kpi_context.first_launch) : UINT32_MAX,
+        KPI_BASELINE_FIRST_LAUNCH, false, true);
+    ok &= kpi_check(F("launches_per_min_x10"), launch_rate, KPI_BASELINE_LAUNCH_RATE, true, false);
+    ok &= kpi_check(F("wall_turns_per_min_x10"), wall_rate, KPI_BASELINE_WALL_TURN_RATE, false, false);
+    ok &= kpi_check(F("compass_timeouts"), kpi_context.events[KPI_COMPASS_TIMEOUTS], KPI_BASELINE_COMPASS_TIMEOUTS, false, false);
+    ok &= kpi_check(F("budget_overruns"), kpi_context.events[KPI_BUDGET_OVERRUNS], KPI_BASELINE_BUDGET_OVERRUNS, false, false);
+    
+    Serial.print(F(",\n\"pass\":"));
+    Serial.print(ok ? F("true") : F("false"));
+    Serial.println(F("}}"));
+}
+
+/************************************************************************/
+/* Help function to print one comparison of a number (@param value)     */
+/* with its baseline (@param baseline), as a minimum (@param at_least)  */
+/* or a maximum. @param first says if it is the first one.              */
+/* @returns whether the baseline is met or not.                         */
+/************************************************************************/
+static bool kpi_check(const __FlashStringHelper *name, uint32_t value, uint32_t baseline, bool at_least, bool first)
+{
+    bool ok = at_least ? (value >= baseline) : (value <= baseline);
+    
+    if (!first) {
+        Serial.println(',');
+    }
+    
+    Serial.print('"');
+    Serial.print(name);
+    Serial.print(F("\":{\"baseline\":"));
+    Serial.print(baseline);
+    Serial.print(F(",\"ok\":"));
+    Serial.print(ok ? F("true") : F("false"));
+    Serial.print('}');
+    
+    return ok;
+}
\ No newline at end of file
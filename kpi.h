@@ -0,0 +1,24 @@
+/************************************************************************/
+/* kpi.h - The .h file for the key performance numbers of a run.        */
+/************************************************************************/
+
+#ifndef KPI_H
+#define KPI_H
+
+/// Counted events.
+#define KPI_BALLS_CAUGHT      0
+#define KPI_LAUNCHES          1
+#define KPI_WALL_TURNS        2
+#define KPI_COMPASS_TIMEOUTS  3
+#define KPI_BUDGET_OVERRUNS   4
+#define KPI_EVENTS            5
+
+/************************************************************************/
+/* Declaration of functions used in kpi.cpp (needed elsewhere).         */
+/************************************************************************/
+void kpi_clear(void);
+void kpi_tick(int8_t);
+void kpi_event(uint8_t);
+void kpi_report(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+/************************************************************************/
+/* magazine.cpp - The .cpp file for the ball magazine.                  */
+/*                                                                      */
+/* Keeps count of the balls held by the robot: one in the catapult      */
+/* (loaded by the lifting arm) and the rest waiting in the bucket.      */
+/* The launch policy decides when the robot goes to the mid wall.       */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "magazine.h"
+#include "config.h"
+#include "robot.h"
+#include "timer.h"
+#include <util/atomic.h>
+
+/// Memory of the magazine for a run.
+typedef struct {
+    /// Number of balls held (catapult and bucket).
+    volatile uint8_t balls;
+    
+    /// Variable saying if the catapult holds a ball.
+    volatile bool in_catapult;
+    
+    /// Time (timer_now() ticks) the first held ball was caught.
+    uint32_t catch_time;
+} magazine_context_t;
+
+/// The magazine of the robot.
+static RUN_LOCAL magazine_context_t magazine_context;
+
+/************************************************************************/
+/* Clears the magazine to the start of a run (empty).                   */
+/************************************************************************/
+void magazine_clear(void)
+{
+    memset(&magazine_context, 0, sizeof(magazine_context_t));
+}
+
+/************************************************************************/
+/* A ball is caught by the bucket.                                      */
+/************************************************************************/
+void magazine_catch(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (magazine_context.balls == 0) {
+            magazine_context.catch_time = timer_now();
+        }
+        
+        if (magazine_context.balls < MAGAZINE_CAPACITY) {
+            magazine_context.balls++;
+        }
+    }
+}
+
+/************************************************************************/
+/* A ball is moved into the catapult by the lifting arm.                */
+/************************************************************************/
+void magazine_load(void)
+{
+    magazine_context.in_catapult = true;
+}
+
+/************************************************************************/
+/* The ball in the catapult is launched.                                */
+/************************************************************************/
+void magazine_launch(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (magazine_context.in_catapult && (magazine_context.balls > 0)) {
+            magazine_context.balls--;
+        }
+        
+        magazine_context.in_catapult = false;
+        
+        /// The hold time of the remaining balls starts over.
+        magazine_context.catch_time = timer_now();
+    }
+}
+
+/************************************************************************/
+/* @returns the number of balls held.                                   */
+/************************************************************************/
+uint8_t magazine_count(void)
+{
+    return magazine_context.balls;
+}
+
+/************************************************************************/
+/* @returns whether the catapult holds a ball or not.                   */
+/************************************************************************/
+bool magazine_loaded(void)
+{
+    return magazine_context.in_catapult;
+}
+
+/************************************************************************/
+/* @returns whether there is room for another ball or not.              */
+/************************************************************************/
+bool magazine_full(void)
+{
+    return (magazine_context.balls >= MAGAZINE_CAPACITY) ? true : false;
+}
+
+/************************************************************************/
+/* @returns whether the robot should go and launch the held balls or    */
+/* not: enough balls are held, the magazine is full, or the first ball  */
+/* has been held for too long.                                          */
+/************************************************************************/
+bool magazine_ready(void)
+{
+    if (magazine_context.balls == 0) {
+        return false;
+    }
+    
+    if ((magazine_context.balls >= MAGAZINE_LAUNCH_COUNT) || magazine_full()) {
+        return true;
+    }
+    
+    return ((MAGAZINE_HOLD_TIME != 0) && ((timer_now() - magazine_context.catch_time) >= MS_TO_TICKS(MAGAZINE_HOLD_TIME))) ? true : false;
+}
\ No newline at end of file
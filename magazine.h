@@ -0,0 +1,20 @@
+/************************************************************************/
+/* magazine.h - The .h file for the ball magazine.                      */
+/************************************************************************/
+
+#ifndef MAGAZINE_H
+#define MAGAZINE_H
+
+/************************************************************************/
+/* Declaration of functions used in magazine.cpp (needed elsewhere).    */
+/************************************************************************/
+void magazine_clear(void);
+void magazine_catch(void);
+void magazine_load(void);
+void magazine_launch(void);
+uint8_t magazine_count(void);
+bool magazine_loaded(void);
+bool magazine_full(void);
+bool magazine_ready(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,182 @@
+/************************************************************************/
+/* nav.cpp - The .cpp file for navigation to the mid wall.              */
+/*                                                                      */
+/* Keeps an estimate of the position of the robot relative to the mid   */
+/* wall by dead reckoning (heading and commanded travel), corrected by  */
+/* top sensor sightings of the wall. The x axis points along the start  */
+/* heading towards the mid wall (x = 0 at the wall), y to the right.    */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "nav.h"
+#include "compass.h"
+#include "config.h"
+#include "robot.h"
+#include "timer.h"
+#include "wheel.h"
+
+/// Servo angle of the top sensor looking straight ahead.
+#define NAV_SENSOR_MID_ANGLE  75
+
+/// Readings closer than this are considered noise (same limit as the top sensor in sensor.cpp).
+#define NAV_MIN_DISTANCE  10
+
+/// A sighting is taken as the mid wall if the sensor looks within this angle of the start heading.
+#define NAV_SIGHTING_ANGLE  15
+
+/// Time between dead reckoning updates (ms).
+#define NAV_PERIOD_TIME  50
+
+/// Memory of the navigation for a run.
+typedef struct {
+    /// Estimated position (cm).
+    float x;
+    float y;
+    
+    /// Variable saying if the distance to the mid wall has been measured.
+    bool fixed;
+    
+    /// Timer for the dead reckoning updates.
+    tick_timer_t timer;
+} nav_context_t;
+
+/// The navigation of the robot.
+static RUN_LOCAL nav_context_t nav_context;
+
+/************************************************************************/
+/* Clears the navigation to the start of a run (at the start position). */
+/************************************************************************/
+void nav_clear(void)
+{
+    memset(&nav_context, 0, sizeof(nav_context_t));
+    
+    nav_context.x = -NAV_START_DISTANCE;
+}
+
+/************************************************************************/
+/* Advances the position estimate. Called from control_tick().          */
+/************************************************************************/
+void nav_tick(void)
+{
+    if (!timer_expired(&nav_context.timer, MS_TO_TICKS(NAV_PERIOD_TIME))) {
+        return;
+    }
+    
+    float speed = nav_speed();
+    
+    /// Turning in place or standing still.
+    if (speed == 0) {
+        return;
+    }
+    
+    /// Distance travelled since the last update (cm).
+    float step = speed * (TICKS_TO_MS(MS_TO_TICKS(NAV_PERIOD_TIME)) / 1000.0);
+    
+    float heading = radians(compass_offset());
+    
+    nav_context.x += step * cos(heading);
+    nav_context.y += step * sin(heading);
+}
+
+/************************************************************************/
+/* @returns the commanded driving speed (cm/s, forwards > 0).           */
+/************************************************************************/
+float nav_speed(void)
+{
+    return wheel_drive_direction() * wheel_speed();
+}
+
+/************************************************************************/
+/* Retrieves the estimated position (@param x and @param y, cm).        */
+/************************************************************************/
+void nav_position(float *x, float *y)
+{
+    *x = nav_context.x;
+    *y = nav_context.y;
+}
+
+/************************************************************************/
+/* Uses a top sensor reading (@param distance) at servo angle           */
+/* (@param angle) to correct the distance to the mid wall.              */
+/************************************************************************/
+void nav_sighting(int16_t angle, uint8_t distance)
+{
+    /// No echo or noise.
+    if (distance < NAV_MIN_DISTANCE) {
+        return;
+    }
+    
+    /// Direction of the sensor relative to the start heading (sensor angles grow to the left).
+    int16_t direction = compass_offset() - (angle - NAV_SENSOR_MID_ANGLE);
+    
+    if (abs(direction) > NAV_SIGHTING_ANGLE) {
+        return;
+    }
+    
+    float wall = distance * cos(radians(direction));
+    
+    /// Obstacles far from the expected wall (e.g. other robots) are ignored once the wall is found.
+    if (nav_context.fixed && (fabs(wall + nav_context.x) > NAV_SIGHTING_TOLERANCE)) {
+        return;
+    }
+    
+    nav_context.x = -wall;
+    nav_context.fixed = true;
+}
+
+/************************************************************************/
+/* The robot has reached the mid wall (top sensor triggered ahead).     */
+/************************************************************************/
+void nav_at_mid_wall(void)
+{
+    nav_context.x = -TOP_SENSOR_TRIGGER_DISTANCE_MID;
+    nav_context.fixed = true;
+}
+
+/************************************************************************/
+/* @returns whether the mid wall has been sighted and the robot is      */
+/* within the launch distance of it or not.                             */
+/************************************************************************/
+bool nav_at_launch_distance(void)
+{
+    return (nav_context.fixed && (nav_context.x >= -NAV_LAUNCH_DISTANCE)) ? true : false;
+}
+
+/************************************************************************/
+/* @returns the heading (relative to the start heading, clockwise > 0)  */
+/* of the straightest drive to the launch position in front of the      */
+/* middle of the mid wall.                                              */
+/************************************************************************/
+int16_t nav_launch_bearing(void)
+{
+    float dx = -NAV_LAUNCH_DISTANCE - nav_context.x;
+    
+    /// Close to the wall - just face it.
+    if (dx < NAV_LAUNCH_DISTANCE) {
+        return 0;
+    }
+    
+    int16_t bearing = (int16_t) degrees(atan2(-nav_context.y, dx));
+    
+    return constrain(bearing, (int16_t) -NAV_MAX_BEARING, (int16_t) NAV_MAX_BEARING);
+}
+
+/************************************************************************/
+/* Prints the position estimate over serial.                            */
+/************************************************************************/
+void nav_print(void)
+{
+    Serial.print(F("x: "));
+    Serial.print(nav_context.x);
+    Serial.print(F(" y: "));
+    Serial.print(nav_context.y);
+    Serial.print(F(" heading: "));
+    Serial.print(compass_offset());
+    Serial.print(F(" bearing: "));
+    Serial.print(nav_launch_bearing());
+    Serial.print(F(" speed: "));
+    Serial.print(nav_speed());
+    Serial.print(F(" trim: "));
+    Serial.print(wheel_trim());
+    Serial.println(nav_context.fixed ? F(" (fixed)") : F(""));
+}
\ No newline at end of file
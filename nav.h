@@ -0,0 +1,21 @@
+/************************************************************************/
+/* nav.h - The .h file for navigation to the mid wall.                  */
+/************************************************************************/
+
+#ifndef NAV_H
+#define NAV_H
+
+/************************************************************************/
+/* Declaration of functions used in nav.cpp (needed elsewhere).         */
+/************************************************************************/
+void nav_clear(void);
+void nav_tick(void);
+float nav_speed(void);
+void nav_position(float *, float *);
+void nav_sighting(int16_t, uint8_t);
+void nav_at_mid_wall(void);
+bool nav_at_launch_distance(void);
+int16_t nav_launch_bearing(void);
+void nav_print(void);
+
+#endif
\ No newline at end of file
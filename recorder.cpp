@@ -0,0 +1,155 @@
+/************************************************************************/
+/* recorder.cpp - The .cpp file for the in-RAM flight recorder.         */
+/*                                                                      */
+/* Keeps the latest state transitions, sensor readings, compass         */
+/* headings and wheel commands in a wrap-around buffer, to be dumped    */
+/* over serial after a run.                                             */
+/*                                                                      */
+/* With REPLAY_CAPTURE (robot.h) every record is also streamed over     */
+/* serial as it is made, so a capture covers the whole run and can be   */
+/* replayed on the host (host/replay.cpp).                              */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "recorder.h"
+#include "robot.h"
+#include "timer.h"
+#include <util/atomic.h>
+
+/// Number of records in the buffer (power of two, 512 * 8 bytes = 4 kB of SRAM).
+#define RECORDER_SIZE  512
+
+/// Memory of the flight recorder for a run.
+typedef struct {
+    /// Records, oldest overwritten first.
+    record_t buffer[RECORDER_SIZE];
+    
+    /// Index of the next record to write.
+    volatile uint16_t head;
+    
+    /// Number of records written (saturates at RECORDER_SIZE).
+    volatile uint16_t length;
+    
+    /// Variable saying if recording is paused (while dumping).
+    volatile bool paused;
+} recorder_context_t;
+
+/// The flight recorder of the robot.
+static RUN_LOCAL recorder_context_t recorder_context;
+
+/// Pre-declaration of help function.
+static void recorder_print(const __FlashStringHelper *, const record_t *);
+
+/************************************************************************/
+/* Clears the flight recorder to the start of a run (empty).            */
+/************************************************************************/
+void recorder_clear(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        memset(&recorder_context, 0, sizeof(recorder_context_t));
+    }
+}
+
+/************************************************************************/
+/* Stores a record of type (@param type) with (@param id) and           */
+/* (@param value), stamped with the current tick. Constant time,        */
+/* overwrites the oldest record.                                        */
+/************************************************************************/
+void recorder_log(uint8_t type, uint8_t id, int16_t value)
+{
+    record_t record;
+    
+    if (recorder_context.paused) {
+        return;
+    }
+    
+    record.tick  = timer_now();
+    record.type  = type;
+    record.id    = id;
+    record.value = value;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        recorder_context.buffer[recorder_context.head] = record;
+        recorder_context.head = (recorder_context.head + 1) & (RECORDER_SIZE - 1);
+        
+        if (recorder_context.length < RECORDER_SIZE) {
+            recorder_context.length++;
+        }
+    }
+    
+#ifdef REPLAY_CAPTURE
+    /// Streams the record. The serial buffer holds a few records, beyond that the
+    /// main loop waits (the ticks keep their recorded order).
+    recorder_print(F("R "), &record);
+#endif
+}
+
+/************************************************************************/
+/* @returns the number of records in the buffer.                        */
+/************************************************************************/
+uint16_t recorder_count(void)
+{
+    uint16_t length;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        length = recorder_context.length;
+    }
+    
+    return length;
+}
+
+/************************************************************************/
+/* Copies record number (@param index), oldest first, to @param record. */
+/************************************************************************/
+void recorder_read(uint16_t index, record_t *record)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint16_t oldest = (recorder_context.head - recorder_context.length) & (RECORDER_SIZE - 1);
+        
+        *record = recorder_context.buffer[(oldest + index) & (RECORDER_SIZE - 1)];
+    }
+}
+
+/************************************************************************/
+/* Pauses (@param pause) or resumes the recording.                      */
+/************************************************************************/
+void recorder_pause(bool pause)
+{
+    recorder_context.paused = pause;
+}
+
+/************************************************************************/
+/* Prints all records over serial, oldest first.                        */
+/************************************************************************/
+void recorder_dump(void)
+{
+    record_t record;
+    
+    /// No new records while dumping.
+    recorder_pause(true);
+    
+    Serial.println(F("// tick type id value"));
+    
+    for (uint16_t i = 0; i < recorder_count(); i++) {
+        recorder_read(i, &record);
+        recorder_print(F(""), &record);
+    }
+    
+    recorder_pause(false);
+}
+
+/************************************************************************/
+/* Help function to print a record (@param record) on one line, after   */
+/* a prefix (@param prefix).                                            */
+/************************************************************************/
+static void recorder_print(const __FlashStringHelper *prefix, const record_t *record)
+{
+    Serial.print(prefix);
+    Serial.print(record->tick);
+    Serial.print(' ');
+    Serial.print(record->type);
+    Serial.print(' ');
+    Serial.print(record->id);
+    Serial.print(' ');
+    Serial.println(record->value);
+}
\ No newline at end of file
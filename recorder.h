@@ -0,0 +1,46 @@
+/************************************************************************/
+/* recorder.h - The .h file for the in-RAM flight recorder.             */
+/************************************************************************/
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "robot.h"
+
+/// Record types.
+#define RECORD_STATE            0  // id: previous state, value: next state
+#define RECORD_BUCKET_SENSOR    1  // value: distance (cm)
+#define RECORD_TOP_SENSOR       2  // id: top sensor servo angle, value: distance (cm)
+#define RECORD_COMPASS          3  // value: heading (degrees)
+#define RECORD_WHEEL_BRAKE      4  // id: wheel, value: ON/OFF
+#define RECORD_WHEEL_DIRECTION  5  // id: wheel, value: FORWARD/BACKWARD
+#define RECORD_WHEEL_SPEED      6  // id: wheel, value: target speed (cm/s)
+#define RECORD_COMPASS_COMMAND  7  // value: command sent to the compass ('C' or 'E')
+#define RECORD_COMMAND          8  // value: serial command
+
+/// A capture records every input, otherwise unchanged inputs are skipped to save the buffer.
+#ifdef REPLAY_CAPTURE
+#define RECORD_ALL_INPUTS  true
+#else
+#define RECORD_ALL_INPUTS  false
+#endif
+
+/// Fixed-size binary record (8 bytes).
+typedef struct {
+    uint32_t tick;   // Ticks run since startup (timer_now(), TICK_PERIOD_MS resolution)
+    uint8_t  type;
+    uint8_t  id;
+    int16_t  value;
+} record_t;
+
+/************************************************************************/
+/* Declaration of functions used in recorder.cpp (needed elsewhere).    */
+/************************************************************************/
+void recorder_clear(void);
+void recorder_log(uint8_t, uint8_t, int16_t);
+uint16_t recorder_count(void);
+void recorder_read(uint16_t, record_t *);
+void recorder_pause(bool);
+void recorder_dump(void);
+
+#endif
\ No newline at end of file
@@ -5,6 +5,24 @@
 #ifndef ROBOT_H
 #define ROBOT_H
 
+/************************************************************************/
+/* Replay definitions.                                                  */
+/************************************************************************/
+/// Stream every record over serial (115200 baud) and record every input, so the run
+/// can be replayed on the host (see host/replay.cpp).
+//#define REPLAY_CAPTURE
+
+/************************************************************************/
+/* Run state definitions.                                               */
+/************************************************************************/
+/// Storage of the module contexts (the state of a run, reset by state_reset()).
+/// The host build runs a robot per thread, so each thread gets its own.
+#ifdef ARDUINO
+#define RUN_LOCAL
+#else
+#define RUN_LOCAL  thread_local
+#endif
+
 /************************************************************************/
 /* Compass definitions.                                                 */
 /************************************************************************/
@@ -17,6 +35,14 @@
 #define MID   0
 #define SIDE  1
 
+/// Ultra sonic sensors. The order is defined by the sonar table in sensor.cpp.
+#define BUCKET_SONAR  0
+#define TOP_SONAR     1
+#define SONAR_COUNT   2
+
+/// Returned by sonar_poll() when no sensor was pinged.
+#define SONAR_NONE  UINT8_MAX
+
 /************************************************************************/
 /* Servo definitions.                                                   */
 /************************************************************************/
@@ -48,6 +74,11 @@
 #define CATAPULT_ARM_UP         9
 #define CATAPULT_UNLOCK         10
 #define CATAPULT_ARM_DOWN       11
+#define COMPASS_CALIBRATION     12
+
+/// Number of states and the index of a state (@param s) in per-state arrays.
+#define STATE_COUNT     (COMPASS_CALIBRATION - LIFTING_ARM_HOME + 1)
+#define STATE_INDEX(s)  ((s) - LIFTING_ARM_HOME)
 
 /************************************************************************/
 /* Wheel definitions.                                                   */
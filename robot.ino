@@ -3,50 +3,106 @@
 /************************************************************************/
 
 #include "robot.h"
+#include "bench.h"
 #include "compass.h"
+#include "config.h"
+#include "contact.h"
+#include "detector.h"
+#include "grid.h"
+#include "kpi.h"
+#include "recorder.h"
+#include "nav.h"
+#include "scan.h"
 #include "sensor.h"
 #include "servo.h"
 #include "state.h"
+#include "sweep.h"
+#include "trace.h"
 #include "timer.h"
 #include "wheel.h"
 
-/// Variable saying when it is OK to update the compass heading.
-/// This variable is polled in the main loop.
-static volatile bool ok_for_compass = false;
+/// Memory of the main loop for a run. The flags are polled in the main loop.
+typedef struct {
+    /// Variable saying when it is OK to update the compass heading.
+    volatile bool ok_for_compass;
+    
+    /// Variable saying when it is OK for the bucket sensor to do a ping request.
+    volatile bool ok_for_bucket_sensor;
+    
+    /// Variable saying when it is OK for the top sensor to do a ping request.
+    volatile bool ok_for_top_sensor;
+    
+    /// Variable saying if new compass heading should be calculated or retrieved.
+    volatile bool new_heading;
+    
+    /// Delay timers of the sensors and the compass.
+    tick_timer_t sensor_timer;
+    tick_timer_t top_sensor_timer;
+} loop_context_t;
+
+/// The main loop of the robot.
+static RUN_LOCAL loop_context_t loop_context;
 
-/// Variable saying when it is OK for the bucket sensor to do a ping request.
-/// This variable is polled in the main loop.
-static volatile bool ok_for_bucket_sensor = false;
+/// Time between bucket sensor pings and compass updates (ms).
+#define SENSOR_PERIOD_TIME  50
 
-/// Variable saying when it is OK for the bucket sensor to do a ping request.
-/// This variable is polled in the main loop.
-static volatile bool ok_for_top_sensor = false;
+/// Time the startup states get before the wheels are released (ms).
+#define STARTUP_TIME  2000
 
-/// Variable saying if new compass heading should be calculated or retrieved.
-static volatile bool new_heading = true;
+/// Pre-declaration of help functions.
+void use_reading(uint8_t);
+void serial_command(int);
+void run_ticks(void);
+void delay_counter(void);
+void loop_clear(void);
+void control_tick(void);
 
 /************************************************************************/
 /* Initialization of the robot.                                         */
 /************************************************************************/
 void setup()
 {
+#ifdef REPLAY_CAPTURE
+    /// Start serial communication, fast enough for the stream of records.
+    Serial.begin(115200);
+#else
     /// Start serial communication.
     Serial.begin(9600);
+#endif
+    
+    /// Reports a reset by the watchdog.
+    timer_watchdog_init();
+    
+    /// Starts the run with every module at its start. A host run may follow another
+    /// one in the same thread.
+    state_reset(state_context());
+    loop_clear();
 
     /// Initialization of the compass.
     compass_init();
     
+    /// Initialization of the servo timers.
+    servo_init();
+    
     /// Initialization of the wheels.
     wheel_init();
     
+    /// Initialization of the ball detector.
+    detector_init();
+    
     /// Initialization of state management.
     state_init();
     
     /// Initialization of Timer4.
     timer4_init();
     
-    /// Two second startup delay.
-    delay(2000);
+    /// Two second startup delay. The startup states run meanwhile, one tick at a time,
+    /// so the run starts on the same tick every time.
+    while (timer_now() < MS_TO_TICKS(STARTUP_TIME)) {
+        if (timer_take_tick()) {
+            control_tick();
+        }
+    }
   
     /// Toggle brakes ON or OFF.
     wheel_toggle_brake(BOTH, OFF);
@@ -57,33 +113,34 @@ void setup()
 /************************************************************************/
 void loop()
 {
-    /// Updates the measured distance of the bucket sensor.
-    if (ok_for_bucket_sensor) {
-        ok_for_bucket_sensor = false;
-        bucket_sensor_update();
+    /// The state machine has priority - pending ticks are run before any sensor I/O.
+    run_ticks();
+    
+    /// Requests a new measurement of the bucket sensor.
+    if (loop_context.ok_for_bucket_sensor) {
+        loop_context.ok_for_bucket_sensor = false;
+        sonar_request(BUCKET_SONAR);
     }
     
-    /// Updates the measured distance of the top sensor.
-    if (ok_for_top_sensor) {
-        ok_for_top_sensor = false;
-        top_sensor_update();
-        
-        /// Rotates the top sensor servo.
-        if (!going_for_mid_wall()) {
-            top_sensor_servo_rotate();
-            
-        /// Rotates the top sensor servo to mid position.
-        } else {
-            top_sensor_servo_mid();
-        }        
+    /// Requests a new measurement of the top sensor.
+    /// No ping is done while the top sensor servo is still moving.
+    if (loop_context.ok_for_top_sensor && sweep_settled()) {
+        loop_context.ok_for_top_sensor = false;
+        sonar_request(TOP_SONAR);
     }
     
+    /// Pings the next requested sensor and uses a complete reading.
+    use_reading(sonar_poll());
+    
+    /// Runs the ticks posted during the ping.
+    run_ticks();
+    
     /// Updates the compass heading.
-    if (ok_for_compass) {
-        ok_for_compass = false;
+    if (loop_context.ok_for_compass) {
+        loop_context.ok_for_compass = false;
         
         /// Calculates new heading.
-        if(new_heading) {
+        if(loop_context.new_heading) {
             compass_update(NEW_HEADING);
         
         /// Retrieves new heading.
@@ -91,50 +148,181 @@ void loop()
             compass_update(GET_HEADING);
         }
         
-        new_heading = !new_heading;
+        loop_context.new_heading = !loop_context.new_heading;
+    }
+    
+    /// Handles serial commands.
+    if (Serial.available()) {
+        serial_command(Serial.read());
     }
 }
 
 /************************************************************************/
-/* Help function to delay sonar ping requests and new compass headings. */
+/* Help function to use a new reading of one sensor (@param id, or      */
+/* SONAR_NONE). Also called by the host replay (host/replay.cpp).       */
+/************************************************************************/
+void use_reading(uint8_t id)
+{
+    switch (id) {
+        case BUCKET_SONAR :
+            /// Feeds the ball detector while looking for balls.
+            if (current_state() == _DEFAULT) {
+                detector_update(sonar_hit(BUCKET_SONAR));
+            }
+            break;
+        case TOP_SONAR :
+            /// Predicts a collision (compares with the previous reading before it is replaced).
+            contact_update(top_servo_angle(), sonar_distance(TOP_SONAR));
+            
+            /// Stores the reading at the current sweep position.
+            scan_update(top_servo_angle(), sonar_distance(TOP_SONAR));
+            
+            /// Corrects the distance to the mid wall.
+            nav_sighting(top_servo_angle(), sonar_distance(TOP_SONAR));
+            
+            /// Remembers the walls in the arena.
+            grid_update(top_servo_angle(), sonar_distance(TOP_SONAR));
+            
+            /// Rotates the top sensor servo to the next sweep position.
+            sweep_step();
+            break;
+    }
+}
+
 /************************************************************************/
-void delay_counter(int8_t state)
+/* Help function to handle a serial command (@param command).           */
+/************************************************************************/
+void serial_command(int command)
 {
-    /// Delay counter variables.
-    static uint8_t delay_counter      = 0;
-    static uint8_t top_sensor_counter = 0;
+    /// Records the command, the host replay sends it again.
+    recorder_log(RECORD_COMMAND, 0, (int16_t) command);
     
-    delay_counter++;
-    top_sensor_counter++;
+    /// Long outputs hold up the state machine for seconds at 9600 baud.
+    switch (command) {
+        case 'd' :
+        case 't' :
+        case 'p' :
+        case 'b' :
+        case 'g' :
+        case 'k' :
+            if (!wheel_braked()) {
+                Serial.println(F("Only while braked"));
+                return;
+            }
+            break;
+    }
     
-    if (delay_counter == 5) {
-        delay_counter = 0;
-        
-        /// Lets the bucket sensor update its measurment.
-        if (state == _DEFAULT || state == BUCKET_IN) {
-            ok_for_bucket_sensor = true;
+    switch (command) {
+        /// Dump the flight recorder.
+        case 'd' :
+            recorder_dump();
+            break;
+        /// Dump the flight recorder as a Chrome trace-event timeline.
+        case 't' :
+            trace_dump();
+            break;
+        /// Print the parameter set.
+        case 'p' :
+            config_print();
+            break;
+        /// Run the micro-benchmarks.
+        case 'b' :
+            bench_run();
+            break;
+        /// Calibrate the compass from the default state.
+        case 'c' :
+            request_compass_calibration();
+            break;
+        /// Print the position estimate.
+        case 'n' :
+            nav_print();
+            break;
+        /// Print the occupancy grid.
+        case 'g' :
+            grid_print();
+            break;
+        /// Print the key performance numbers of the run.
+        case 'k' :
+            kpi_report();
+            break;
+    }
+}
+
+/************************************************************************/
+/* Help function to run the ticks posted by the Timer4 ISR, catching up */
+/* when the main loop has been busy.                                    */
+/************************************************************************/
+void run_ticks(void)
+{
+    for (uint16_t ticks = timer_take_ticks(); ticks > 0; ticks--) {
+        control_tick();
+    }
+}
+
+/************************************************************************/
+/* Help function to clear the main loop to the start of a run.          */
+/************************************************************************/
+void loop_clear(void)
+{
+    memset(&loop_context, 0, sizeof(loop_context_t));
+    
+    loop_context.new_heading = true;
+}
+
+/************************************************************************/
+/* Help function to delay sonar ping requests and new compass headings. */
+/************************************************************************/
+void delay_counter(void)
+{
+    if (timer_expired(&loop_context.sensor_timer, MS_TO_TICKS(SENSOR_PERIOD_TIME))) {
+        /// Lets the bucket sensor update its measurment, if the state uses it.
+        if (sonar_range(BUCKET_SONAR) != 0) {
+            loop_context.ok_for_bucket_sensor = true;
         }
         
          /// Lets the compass update its heading.
-        ok_for_compass = true;
+        loop_context.ok_for_compass = true;
     }
     
-    if (top_sensor_counter == 20) {
-        top_sensor_counter = 0;
-        
-        /// Lets the top sensor update its measurment.
-        if (state == _DEFAULT) {
-            ok_for_top_sensor = true;
-        }        
+    if (timer_expired(&loop_context.top_sensor_timer, sweep_period())) {
+        /// Lets the top sensor update its measurment, if the state uses it.
+        if (sonar_range(TOP_SONAR) != 0) {
+            loop_context.ok_for_top_sensor = true;
+        }
     }
 }
 
 /************************************************************************/
-/* Interrupt Service Routine for Timer4.                                */
+/* One tick of the state machine. Runs in the main loop.                */
 /************************************************************************/
-void timer4_isr(void)
+void control_tick(void)
 {
-    int8_t state = current_state();
+    state_context_t *ctx = state_context();
+    int8_t state = ctx->state;
+    
+    /// Start time for profiling the state handler.
+    unsigned long start = micros();
+    
+    /// Advances the run time.
+    timer_tick();
+    
+    /// Advances the heading estimate.
+    compass_tick();
+    
+    /// Advances the position estimate.
+    nav_tick();
+    
+    /// Learns the wheel trim.
+    wheel_tick();
+    
+    /// Leaves the current state if it ran out of its time budget.
+    state_budget_tick(ctx);
+    
+    /// The state may have changed.
+    state = ctx->state;
+    
+    /// Counts the time of the run per state.
+    kpi_tick(state);
     
     switch(state) {
         /// Startup states.
@@ -142,19 +330,19 @@ void timer4_isr(void)
         
         /// Move the lifting arm to home position.
         case -4 :
-            lifting_arm_down();
+            lifting_arm_down(ctx);
             break;
         /// Rotate the bucket to home position.
         case -3 :
-            bucket_out();
+            bucket_out(ctx);
             break;
         /// Move the catapult arm to home position.
         case -2 :
-            catapult_arm_down();
+            catapult_arm_down(ctx);
             break;
         /// Move the catapult locking servo to home position.
         case -1 :
-            catapult_unlock();
+            catapult_unlock(ctx);
             break;
         
         /// Regular states.
@@ -162,53 +350,60 @@ void timer4_isr(void)
         
         /// Default state. Wait for either sensor to give interesting input.
         case 0 :
-            default_state();
+            default_state(ctx);
             break;
         /// Rotate the bucket in hope of catching a ball.
         case 1 :
-            bucket_in();
+            bucket_in(ctx);
             break;
         /// In case of ball present in the bucket: Move the lifting arm to upper position.
         case 2 :
-            lifting_arm_up();
+            lifting_arm_up(ctx);
             break;
         /// Move the lifting arm to lower position.
         case 3 :
-            lifting_arm_down();
+            lifting_arm_down(ctx);
             break;        
         /// Rotate the bucket to home position.
         case 4 :
-            bucket_out();
+            bucket_out(ctx);
             break;
         /// Turn to mid wall.
         case 5 :
-            turn_to_mid_wall();
+            turn_to_mid_wall(ctx);
             break;
         /// Turn in case of too close to a wall.
         case 6 :
-            turn_for_wall();
+            turn_for_wall(ctx);
             break;
         /// Turn left to prepare for launch.
         case 7 :
-            turn_to_launch();
+            turn_to_launch(ctx);
             break;
         /// Lock the catapult.
         case 8 :
-            catapult_lock();
+            catapult_lock(ctx);
             break;
         /// Tighten the catapult.
         case 9 :
-            catapult_arm_up();
+            catapult_arm_up(ctx);
             break;
         /// Release the catapult.
         case 10 :
-            catapult_unlock();
+            catapult_unlock(ctx);
             break;
         /// Untighten the catapult.
         case 11 :
-            catapult_arm_down();
+            catapult_arm_down(ctx);
+            break;
+        /// Calibrate the compass.
+        case 12 :
+            compass_calibration_state(ctx);
             break;
     }
     
-    delay_counter(state);
+    /// Profiles the state handler.
+    bench_profile(BENCH_STATE(state), micros() - start);
+    
+    delay_counter();
 }
\ No newline at end of file
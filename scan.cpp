@@ -0,0 +1,239 @@
+/************************************************************************/
+/* scan.cpp - The .cpp file for the polar scan map of the top sensor.   */
+/*                                                                      */
+/* Holds the latest filtered distance for every sweep position of the   */
+/* top sensor servo, so decisions can use the whole sweep.              */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "scan.h"
+#include "robot.h"
+#include "servo.h"
+#include "timer.h"
+#include <util/atomic.h>
+
+/// Sweep positions of the top sensor servo.
+/// Must match TOP_SENSOR_SERVO_MIN/MAX and the step size in servo.cpp.
+#define SCAN_MIN_ANGLE  15
+#define SCAN_STEP       30
+#define SCAN_SLOTS      5
+
+/// Index of the slot pointing straight ahead.
+#define SCAN_MID_SLOT  (SCAN_SLOTS / 2)
+
+/// Distance stored when the sensor reports no echo (same as TOP_SENSOR_MAX_DISTANCE).
+#define SCAN_FAR_DISTANCE  50
+
+/// Readings closer than this are considered noise (same limit as the top sensor in sensor.cpp).
+#define SCAN_MIN_DISTANCE  10
+
+/// Age in ms before a reading is considered stale. A full sweep takes about 1.6 seconds.
+#define SCAN_MAX_AGE  2000
+
+/// Memory of the sweep positions for a run.
+typedef struct {
+    /// Filtered distance of each sweep position.
+    uint8_t slot_distance[SCAN_SLOTS];
+    
+    /// Time (timer_now() ticks) of the latest reading of each sweep position.
+    uint32_t slot_time[SCAN_SLOTS];
+} scan_context_t;
+
+/// The sweep positions of the robot.
+static RUN_LOCAL scan_context_t scan_context;
+
+/// Pre-declaration of help functions.
+static int8_t scan_slot(int16_t);
+static bool scan_slot_fresh(uint8_t);
+
+/************************************************************************/
+/* Clears the sweep positions to the start of a run (no readings).      */
+/************************************************************************/
+void scan_clear(void)
+{
+    memset(&scan_context, 0, sizeof(scan_context_t));
+}
+
+/************************************************************************/
+/* Stores a reading (@param distance) taken at servo angle              */
+/* (@param angle).                                                      */
+/************************************************************************/
+void scan_update(int16_t angle, uint8_t distance)
+{
+    int8_t slot = scan_slot(angle);
+
+    /// Not a sweep position.
+    if (slot < 0) {
+        return;
+    }
+
+    /// No echo means nothing within range.
+    if (distance == 0) {
+        distance = SCAN_FAR_DISTANCE;
+
+    /// Too close to be a valid reading.
+    } else if (distance < SCAN_MIN_DISTANCE) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_FORCEON) {
+        /// A closer obstacle is taken as is, a farther one is averaged to suppress dropouts.
+        if (scan_slot_fresh(slot) && (distance > scan_context.slot_distance[slot])) {
+            distance = (uint8_t) ((distance + scan_context.slot_distance[slot] + 1) / 2);
+        }
+
+        scan_context.slot_distance[slot] = distance;
+        scan_context.slot_time[slot] = timer_now();
+    }
+}
+
+/************************************************************************/
+/* @returns the filtered distance at servo angle (@param angle).        */
+/************************************************************************/
+uint8_t scan_distance(int16_t angle)
+{
+    int8_t slot = scan_slot(angle);
+
+    if ((slot < 0) || !scan_slot_fresh(slot)) {
+        return SCAN_UNKNOWN;
+    }
+
+    return scan_context.slot_distance[slot];
+}
+
+/************************************************************************/
+/* @returns the age (ms) of the reading at servo angle (@param angle)   */
+/* or UINT16_MAX.                                                       */
+/************************************************************************/
+uint16_t scan_age(int16_t angle)
+{
+    int8_t slot = scan_slot(angle);
+    uint32_t time;
+
+    if ((slot < 0) || !scan_slot_fresh(slot)) {
+        return UINT16_MAX;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_FORCEON) {
+        time = scan_context.slot_time[slot];
+    }
+
+    return (uint16_t) TICKS_TO_MS(timer_now() - time);
+}
+
+/************************************************************************/
+/* @returns the bearing of the nearest obstacle (degrees, left > 0).    */
+/************************************************************************/
+int16_t scan_nearest_bearing(void)
+{
+    uint8_t nearest = SCAN_MID_SLOT;
+    uint8_t distance = UINT8_MAX;
+
+    for (uint8_t i = 0; i < SCAN_SLOTS; i++) {
+        if (scan_slot_fresh(i) && (scan_context.slot_distance[i] < distance)) {
+            distance = scan_context.slot_distance[i];
+            nearest = i;
+        }
+    }
+
+    return (int16_t) (nearest - SCAN_MID_SLOT) * SCAN_STEP;
+}
+
+/************************************************************************/
+/* @returns the distance to the nearest obstacle or SCAN_UNKNOWN.       */
+/************************************************************************/
+uint8_t scan_nearest_distance(void)
+{
+    uint8_t distance = UINT8_MAX;
+
+    for (uint8_t i = 0; i < SCAN_SLOTS; i++) {
+        if (scan_slot_fresh(i) && (scan_context.slot_distance[i] < distance)) {
+            distance = scan_context.slot_distance[i];
+        }
+    }
+
+    return (distance == UINT8_MAX) ? SCAN_UNKNOWN : distance;
+}
+
+/************************************************************************/
+/* @returns the width in degrees of the widest sector with no obstacle  */
+/* closer than @param min_distance.                                     */
+/************************************************************************/
+uint8_t scan_free_sector_width(uint8_t min_distance)
+{
+    uint8_t width = 0;
+    uint8_t widest = 0;
+
+    for (uint8_t i = 0; i < SCAN_SLOTS; i++) {
+        /// Stale positions are not known to be free.
+        if (scan_slot_fresh(i) && (scan_context.slot_distance[i] > min_distance)) {
+            width++;
+
+            if (width > widest) {
+                widest = width;
+            }
+        } else {
+            width = 0;
+        }
+    }
+
+    return widest * SCAN_STEP;
+}
+
+/************************************************************************/
+/* @returns the clearance on one side (@param side) or SCAN_UNKNOWN.    */
+/************************************************************************/
+uint8_t scan_clearance(uint8_t side)
+{
+    uint8_t first = (side == LEFT) ? (SCAN_MID_SLOT + 1) : 0;
+    uint8_t last  = (side == LEFT) ? SCAN_SLOTS : SCAN_MID_SLOT;
+    uint8_t clearance = UINT8_MAX;
+
+    for (uint8_t i = first; i < last; i++) {
+        if (scan_slot_fresh(i) && (scan_context.slot_distance[i] < clearance)) {
+            clearance = scan_context.slot_distance[i];
+        }
+    }
+
+    return (clearance == UINT8_MAX) ? SCAN_UNKNOWN : clearance;
+}
+
+/************************************************************************/
+/* @returns the most open side (LEFT or RIGHT) of the whole sweep.      */
+/************************************************************************/
+uint8_t scan_open_side(void)
+{
+    uint8_t left  = scan_clearance(LEFT);
+    uint8_t right = scan_clearance(RIGHT);
+
+    if (left > right) {
+        return LEFT;
+    } else if (right > left) {
+        return RIGHT;
+    }
+
+    /// No difference - turn away from where the top sensor is looking.
+    return top_servo_right_angle() ? LEFT : RIGHT;
+}
+
+/************************************************************************/
+/* @returns the slot of servo angle (@param angle) or -1.               */
+/************************************************************************/
+static int8_t scan_slot(int16_t angle)
+{
+    if ((angle < SCAN_MIN_ANGLE) || (((angle - SCAN_MIN_ANGLE) % SCAN_STEP) != 0)) {
+        return -1;
+    }
+
+    int16_t slot = (angle - SCAN_MIN_ANGLE) / SCAN_STEP;
+
+    return (slot < SCAN_SLOTS) ? (int8_t) slot : -1;
+}
+
+/************************************************************************/
+/* @returns whether the reading of a slot (@param slot) is fresh or not.*/
+/************************************************************************/
+static bool scan_slot_fresh(uint8_t slot)
+{
+    return ((scan_context.slot_time[slot] != 0) && ((timer_now() - scan_context.slot_time[slot]) < MS_TO_TICKS(SCAN_MAX_AGE))) ? true : false;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+/************************************************************************/
+/* scan.h - The .h file for the polar scan map of the top sensor.       */
+/************************************************************************/
+
+#ifndef SCAN_H
+#define SCAN_H
+
+/// Value reported when no fresh reading is available.
+#define SCAN_UNKNOWN  0
+
+/************************************************************************/
+/* Declaration of functions used in scan.cpp (needed elsewhere).        */
+/************************************************************************/
+void scan_clear(void);
+void scan_update(int16_t, uint8_t);
+uint8_t scan_distance(int16_t);
+uint16_t scan_age(int16_t);
+int16_t scan_nearest_bearing(void);
+uint8_t scan_nearest_distance(void);
+uint8_t scan_free_sector_width(uint8_t);
+uint8_t scan_clearance(uint8_t);
+uint8_t scan_open_side(void);
+
+#endif
\ No newline at end of file
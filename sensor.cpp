@@ -1,9 +1,21 @@
 /************************************************************************/
 /* sensor.cpp - The .cpp file for using ultra sonic sensors.            */
+/*                                                                      */
+/* All sensors are described in one table and read through one indexed  */
+/* API. Pings are fired round-robin and spaced so echoes don't          */
+/* cross-talk between sensors.                                          */
+/*                                                                      */
+/* sonar_poll() fires at most one ping per call, so the main loop never */
+/* waits longer than one echo timeout. A median reading is collected    */
+/* over several calls.                                                  */
 /************************************************************************/
 
 #include "Arduino.h"
 #include "sensor.h"
+#include "config.h"
+#include "recorder.h"
+#include "robot.h"
+#include "servo.h"
 #include <NewPing.h>
 #include <util/atomic.h>
 
@@ -13,71 +25,227 @@
 #define TOP_SENSOR_TRIG_PIN     40
 #define TOP_SENSOR_ECHO_PIN     42
 
-/// Max distances for ultra sonic sensors to report.
+/// Max distances for ultra sonic sensors to report (upper limit of the ranges).
 #define BUCKET_SENSOR_MAX_DISTANCE  20
 #define TOP_SENSOR_MAX_DISTANCE     50
 
-/// Distances for the system to get triggered.
-#define BUCKET_SENSOR_TRIGGER_DISTANCE    15
-#define TOP_SENSOR_TRIGGER_DISTANCE_MID   16
-#define TOP_SENSOR_TRIGGER_DISTANCE_SIDE  18
+/// Minimum time between two pings (ms). An echo from beyond the range (up to about
+/// 5 m, the sensor's own limit) takes this long to return, so it can't reach the next ping.
+#define SONAR_PING_GAP  29
 
-/// Initialization of array holding the top sensor trigger distances.
-static const uint8_t top_sensor_trigger_distance[2] = {
-    TOP_SENSOR_TRIGGER_DISTANCE_MID,
-    TOP_SENSOR_TRIGGER_DISTANCE_SIDE
+/// Time for echoes from beyond the range (arena walls) to die out after a ping (ms).
+/// The gap to the next ping is this plus the echo time of the range, at least SONAR_PING_GAP.
+#define SONAR_ECHO_FADE  10
+
+/// Round trip time of sound per cm of distance (us).
+#define SONAR_US_ROUNDTRIP_CM  57
+
+/// Readings within this range use a single ping, a median doesn't pay off that close (cm).
+#define SONAR_SINGLE_PING_RANGE  20
+
+/// Maximum number of pings per reading.
+#define SONAR_MEDIAN_MAX  5
+
+/// Description of one ultra sonic sensor.
+typedef struct {
+    uint8_t trig_pin;
+    uint8_t echo_pin;
+    uint8_t max_distance;         // cm, also sets the echo timeout
+    uint8_t min_distance;         // cm, closer readings are noise
+    uint8_t trigger_distance[2];  // cm, MID and SIDE
+    uint8_t median;               // number of pings per reading beyond SONAR_SINGLE_PING_RANGE
+    uint8_t record;               // flight recorder type
+    bool    sweeping;             // mounted on the top sensor servo
+} sonar_config_t;
+
+/// Initialization of the table describing the sensors.
+/// The order of this table is defined in robot.h
+/// Per thread on the host, where the tuner sets the trigger distances of each run (tuner.h).
+static RUN_LOCAL const sonar_config_t sonar_config[SONAR_COUNT] = {
+    /// Bucket sensor.
+    {
+        BUCKET_SENSOR_TRIG_PIN, BUCKET_SENSOR_ECHO_PIN, BUCKET_SENSOR_MAX_DISTANCE, 1,
+        {BUCKET_SENSOR_TRIGGER_DISTANCE, BUCKET_SENSOR_TRIGGER_DISTANCE},
+        1, RECORD_BUCKET_SENSOR, false
+    },
+    /// Top sensor.
+    {
+        TOP_SENSOR_TRIG_PIN, TOP_SENSOR_ECHO_PIN, TOP_SENSOR_MAX_DISTANCE, 10,
+        {TOP_SENSOR_TRIGGER_DISTANCE_MID, TOP_SENSOR_TRIGGER_DISTANCE_SIDE},
+        3, RECORD_TOP_SENSOR, true
+    }
 };
 
+/// Sonar object of one sensor (@param id), built from its table entry.
+#define SONAR_NEWPING(id)  NewPing(sonar_config[id].trig_pin, sonar_config[id].echo_pin, sonar_config[id].max_distance)
+
 /// Initialization of sonar objects.
-NewPing bucket_sensor(BUCKET_SENSOR_TRIG_PIN, BUCKET_SENSOR_ECHO_PIN, BUCKET_SENSOR_MAX_DISTANCE);
-NewPing top_sensor(TOP_SENSOR_TRIG_PIN, TOP_SENSOR_ECHO_PIN, TOP_SENSOR_MAX_DISTANCE);
+static NewPing sonar[SONAR_COUNT] = {
+    SONAR_NEWPING(BUCKET_SONAR),
+    SONAR_NEWPING(TOP_SONAR)
+};
+
+/// Memory of the sensors for a run.
+typedef struct {
+    /// Latest distance retrieved from the ultra sonic sensors (atomic).
+    uint8_t distance_atomic[SONAR_COUNT];
+    
+    /// Latest distance of the sensors (not reset when triggered).
+    uint8_t distance_latest[SONAR_COUNT];
+    
+    /// Range (cm) of the sensors, 0 when not in use.
+    uint8_t range_cm[SONAR_COUNT];
+    
+    /// Sensors waiting for a ping.
+    volatile bool requested[SONAR_COUNT];
+    
+    /// Echoes (cm) of the reading being collected, the number of echoes and the
+    /// number of pings so far.
+    uint8_t echo[SONAR_COUNT][SONAR_MEDIAN_MAX];
+    uint8_t echoes[SONAR_COUNT];
+    uint8_t pings[SONAR_COUNT];
+    
+    /// Index of the latest pinged sensor.
+    uint8_t last;
+    
+    /// Time (ms) the latest ping was completed and the gap (ms) to the next ping.
+    unsigned long last_time;
+    uint8_t gap;
+    
+    /// Number of completed readings of the sensors.
+    uint16_t readings[SONAR_COUNT];
+} sonar_context_t;
+
+/// The sensors of the robot.
+static RUN_LOCAL sonar_context_t sonar_context;
 
-/// Atomic variables holding the latest distance retrieved from the ultra sonic sensors.
-static uint8_t bucket_sensor_distance_atomic = UINT8_MAX;
-static uint8_t top_sensor_distance_atomic    = UINT8_MAX;
+/// Pre-declaration of help functions.
+static bool sonar_update(uint8_t);
+static uint8_t sonar_median(uint8_t);
 
 /************************************************************************/
-/* Updates the measured distance of the bucket sensor.                  */
+/* Clears the sensors to the start of a run (no readings, all off).     */
 /************************************************************************/
-void bucket_sensor_update(void)
+void sonar_clear(void)
 {
-    /// Retrieving distance from sensor.
-    uint8_t distance = (uint8_t) bucket_sensor.ping_cm();
+    memset(&sonar_context, 0, sizeof(sonar_context_t));
     
-    /// Stores the distance in an atomic variable.
-    ATOMIC_BLOCK(ATOMIC_FORCEON) {
-        bucket_sensor_distance_atomic = distance;
+    for (uint8_t id = 0; id < SONAR_COUNT; id++) {
+        sonar_context.distance_atomic[id] = UINT8_MAX;
+    }
+    
+    sonar_context.last = SONAR_COUNT - 1;
+}
+
+/************************************************************************/
+/* Sets the range (@param range, cm) of one sensor (@param id). The     */
+/* echo timeout follows the range. 0 turns the sensor off.              */
+/************************************************************************/
+void sonar_set_range(uint8_t id, uint8_t range)
+{
+    sonar_context.range_cm[id] = min(range, sonar_config[id].max_distance);
+    
+    /// No ping is pending for a sensor that is off.
+    if (range == 0) {
+        sonar_context.requested[id] = false;
+        sonar_context.echoes[id] = 0;
+        sonar_context.pings[id]  = 0;
+    }
+}
+
+/************************************************************************/
+/* @returns the range (cm) of one sensor (@param id), 0 when off.       */
+/************************************************************************/
+uint8_t sonar_range(uint8_t id)
+{
+    return sonar_context.range_cm[id];
+}
+
+/************************************************************************/
+/* Requests a new reading of one sensor (@param id). Ignored while the  */
+/* sensor is off.                                                       */
+/************************************************************************/
+void sonar_request(uint8_t id)
+{
+    if (sonar_context.range_cm[id] != 0) {
+        sonar_context.requested[id] = true;
+    }
+}
+
+/************************************************************************/
+/* Pings the next requested sensor in round-robin order, if the gap     */
+/* since the latest ping has passed. A sensor stays requested until its */
+/* reading is complete.                                                 */
+/* @returns the index of the sensor with a new reading or SONAR_NONE.   */
+/************************************************************************/
+uint8_t sonar_poll(void)
+{
+    if ((millis() - sonar_context.last_time) < sonar_context.gap) {
+        return SONAR_NONE;
     }
+    
+    for (uint8_t i = 1; i <= SONAR_COUNT; i++) {
+        uint8_t id = (sonar_context.last + i) % SONAR_COUNT;
+        
+        if (sonar_context.requested[id]) {
+            sonar_context.last = id;
+            
+            bool complete = sonar_update(id);
+            
+            sonar_context.last_time = millis();
+            sonar_context.gap = max(SONAR_PING_GAP, SONAR_ECHO_FADE + (((uint16_t) sonar_context.range_cm[id] * SONAR_US_ROUNDTRIP_CM + 999) / 1000));
+            
+            if (complete) {
+                sonar_context.requested[id] = false;
+                
+                return id;
+            }
+            
+            return SONAR_NONE;
+        }
+    }
+    
+    return SONAR_NONE;
 }
 
 /************************************************************************/
-/* Updates the measured distance of the top sensor.                     */
+/* Stores a complete reading (@param distance, cm) of one sensor        */
+/* (@param id). Called when the pings of a reading are done, and by the */
+/* host replay with the recorded readings.                              */
 /************************************************************************/
-void top_sensor_update(void)
+void sonar_store(uint8_t id, uint8_t distance)
 {
-    /// Retrieving distance from sensor.
-    long time = top_sensor.ping_median(3);
-    uint8_t distance = (uint8_t) top_sensor.convert_cm(time);
+    const sonar_config_t *config = &sonar_config[id];
+    
+    sonar_context.readings[id]++;
     
     /// Stores the distance in an atomic variable.
     ATOMIC_BLOCK(ATOMIC_FORCEON) {
-        top_sensor_distance_atomic = distance;
+        sonar_context.distance_atomic[id] = distance;
+    }
+    
+    /// Records the reading together with the sweep position.
+    if (config->sweeping) {
+        recorder_log(config->record, (uint8_t) top_servo_angle(), distance);
+        
+    /// Records changes only, a fixed sensor mostly reports no echo.
+    } else if (RECORD_ALL_INPUTS || (distance != sonar_context.distance_latest[id])) {
+        recorder_log(config->record, 0, distance);
     }
     
-    Serial.print(bucket_sensor_distance_atomic);
-    Serial.print("  ");
-    Serial.println(top_sensor_distance_atomic);
+    sonar_context.distance_latest[id] = distance;
 }
 
 /************************************************************************/
-/* @returns true or false whether the bucket sensor is triggered or not.*/
+/* @returns whether one sensor (@param id) is triggered at the MID or   */
+/* SIDE distance (@param val) or not. The reading is used up.           */
 /************************************************************************/
-bool bucket_sensor_triggered(void)
+bool sonar_triggered(uint8_t id, uint8_t val)
 {
     bool triggered = false;
     
-    if ((bucket_sensor_distance_atomic > 0) && (bucket_sensor_distance_atomic <= BUCKET_SENSOR_TRIGGER_DISTANCE)) {
-        bucket_sensor_distance_atomic = UINT8_MAX;
+    if (sonar_within(id, val)) {
+        sonar_context.distance_atomic[id] = UINT8_MAX;
         triggered = true;
     }
     
@@ -85,16 +253,97 @@ bool bucket_sensor_triggered(void)
 }
 
 /************************************************************************/
-/* @returns true or false whether the top sensor is triggered or not.   */
+/* @returns whether the unused reading of one sensor (@param id) is     */
+/* within the MID or SIDE distance (@param val) or not. Unlike          */
+/* sonar_triggered() the reading is not used up.                        */
 /************************************************************************/
-bool top_sensor_triggered(uint8_t val)
+bool sonar_within(uint8_t id, uint8_t val)
 {
-    bool triggered = false;
+    return ((sonar_context.distance_atomic[id] >= sonar_config[id].min_distance) &&
+        (sonar_context.distance_atomic[id] <= sonar_config[id].trigger_distance[val])) ? true : false;
+}
+
+/************************************************************************/
+/* @returns whether the latest distance of one sensor (@param id) is    */
+/* within MID trigger distance or not. Unlike sonar_triggered() nothing */
+/* is reset.                                                            */
+/************************************************************************/
+bool sonar_hit(uint8_t id)
+{
+    return ((sonar_context.distance_latest[id] >= sonar_config[id].min_distance) &&
+        (sonar_context.distance_latest[id] <= sonar_config[id].trigger_distance[MID])) ? true : false;
+}
+
+/************************************************************************/
+/* @returns the latest distance measured by one sensor (@param id).     */
+/************************************************************************/
+uint8_t sonar_distance(uint8_t id)
+{
+    return sonar_context.distance_latest[id];
+}
+
+/************************************************************************/
+/* @returns the number of completed readings of one sensor (@param id). */
+/************************************************************************/
+uint16_t sonar_reading_count(uint8_t id)
+{
+    return sonar_context.readings[id];
+}
+
+/************************************************************************/
+/* Help function to ping one sensor (@param id) once and update its     */
+/* measured distance when the reading is complete.                      */
+/* @returns whether the reading is complete or not.                     */
+/************************************************************************/
+static bool sonar_update(uint8_t id)
+{
+    const sonar_config_t *config = &sonar_config[id];
     
-    if ((top_sensor_distance_atomic >= 10) && (top_sensor_distance_atomic <= top_sensor_trigger_distance[val])) {
-        top_sensor_distance_atomic = UINT8_MAX;
-        triggered = true;
+    /// Retrieving one echo from sensor. Echoes beyond the range are reported as no echo (0).
+    uint8_t echo  = (uint8_t) sonar[id].ping_cm(sonar_context.range_cm[id]);
+    uint8_t pings = (sonar_context.range_cm[id] <= SONAR_SINGLE_PING_RANGE) ? 1 : min(config->median, SONAR_MEDIAN_MAX);
+    
+    if (echo != 0) {
+        sonar_context.echo[id][sonar_context.echoes[id]++] = echo;
     }
     
-    return triggered;
+    /// More pings to go.
+    if (++sonar_context.pings[id] < pings) {
+        return false;
+    }
+    
+    sonar_store(id, sonar_median(id));
+    
+    sonar_context.echoes[id] = 0;
+    sonar_context.pings[id]  = 0;
+    
+    return true;
+}
+
+/************************************************************************/
+/* Help function that @returns the median of the echoes of one sensor   */
+/* (@param id), or 0 (no echo) when there are none.                     */
+/************************************************************************/
+static uint8_t sonar_median(uint8_t id)
+{
+    uint8_t *echo = sonar_context.echo[id];
+    uint8_t count = sonar_context.echoes[id];
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    /// Insertion sort, there are only a few echoes.
+    for (uint8_t i = 1; i < count; i++) {
+        uint8_t value = echo[i];
+        uint8_t j = i;
+        
+        for (; (j > 0) && (echo[j - 1] > value); j--) {
+            echo[j] = echo[j - 1];
+        }
+        
+        echo[j] = value;
+    }
+    
+    return echo[count / 2];
 }
\ No newline at end of file
@@ -8,9 +8,16 @@
 /************************************************************************/
 /* Declaration of functions used in sensor.cpp (needed elsewhere).      */
 /************************************************************************/
-void bucket_sensor_update(void);
-void top_sensor_update(void);
-bool bucket_sensor_triggered(void);
-bool top_sensor_triggered(uint8_t);
+void sonar_clear(void);
+void sonar_set_range(uint8_t, uint8_t);
+uint8_t sonar_range(uint8_t);
+void sonar_request(uint8_t);
+uint8_t sonar_poll(void);
+void sonar_store(uint8_t, uint8_t);
+bool sonar_triggered(uint8_t, uint8_t);
+bool sonar_within(uint8_t, uint8_t);
+bool sonar_hit(uint8_t);
+uint8_t sonar_distance(uint8_t);
+uint16_t sonar_reading_count(uint8_t);
 
 #endif
\ No newline at end of file
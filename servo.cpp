@@ -5,14 +5,26 @@
 #include "Arduino.h"
 #include "servo.h"
 #include "robot.h"
-#include <Servo.h>
+#include <util/atomic.h>
 
 // Arduino specific pins for servos.
-#define LIFTING_ARM_SERVO_PIN       5
-#define BUCKET_ROTATION_SERVO_PIN   48
-#define CATAPULT_ARM_SERVO_PIN      2
-#define CATAPULT_LOCKING_SERVO_PIN  4
-#define TOP_SENSOR_SERVO_PIN        10
+// The pulses are generated by the output compare units of Timer3 and Timer5,
+// so every servo must be on one of their pins (OC3A/B = 5/2, OC5A/B/C = 46/45/44).
+#define LIFTING_ARM_SERVO_PIN       5   // OC3A
+#define BUCKET_ROTATION_SERVO_PIN   45  // OC5B
+#define CATAPULT_ARM_SERVO_PIN      2   // OC3B
+#define CATAPULT_LOCKING_SERVO_PIN  46  // OC5A
+#define TOP_SENSOR_SERVO_PIN        44  // OC5C
+
+/// Servo pulse period: 16 MHz / 8 prescaler / 40000 = 50 Hz.
+#define SERVO_TIMER_TOP             39999
+
+/// Timer counts per microsecond (16 MHz / 8 prescaler).
+#define SERVO_COUNTS_PER_US         2
+
+/// Pulse widths in microseconds at 0 and 180 degrees (same as the Servo library).
+#define SERVO_MIN_PULSE             544
+#define SERVO_MAX_PULSE             2400
 
 /// Servo min- and max angle values. Be careful here!
 /// These values depend on the increment- and decrement amount specified in state.cpp
@@ -31,11 +43,11 @@
 #define TOP_SENSOR_SERVO_MIN        15
 #define TOP_SENSOR_SERVO_MAX        135
 
-/// Initialization of array holding the servo objects.
-/// The order of this array is defined in robot.h
-static Servo servo[5];
+/// Angle of each top sensor servo step.
+#define TOP_SENSOR_SERVO_STEP       30
 
 /// Initialization of array holding the Arduino specific pins.
+/// The order of this array is defined in robot.h
 static const uint8_t servo_pin[5] = {
     LIFTING_ARM_SERVO_PIN,
     BUCKET_ROTATION_SERVO_PIN,
@@ -44,6 +56,35 @@ static const uint8_t servo_pin[5] = {
     TOP_SENSOR_SERVO_PIN
 };
 
+/// Initialization of array holding the output compare register of each servo.
+/// The host build simulates the registers per thread.
+static RUN_LOCAL volatile uint16_t * const servo_ocr[5] = {
+    &OCR3A,
+    &OCR5B,
+    &OCR3B,
+    &OCR5A,
+    &OCR5C
+};
+
+/// Initialization of array holding the timer control register of each servo.
+static RUN_LOCAL volatile uint8_t * const servo_tccr[5] = {
+    &TCCR3A,
+    &TCCR5A,
+    &TCCR3A,
+    &TCCR5A,
+    &TCCR5A
+};
+
+/// Initialization of array holding the compare output mode bit of each servo.
+/// Setting the bit puts the pulses on the pin, clearing it makes the pin low.
+static const uint8_t servo_com[5] = {
+    (1 << COM3A1),
+    (1 << COM5B1),
+    (1 << COM3B1),
+    (1 << COM5A1),
+    (1 << COM5C1)
+};
+
 /// Initialization of array holding the servo MIN angle values.
 static const uint8_t servo_min_angle[5] = {
     LIFTING_ARM_SERVO_MIN,
@@ -62,9 +103,9 @@ static const uint8_t servo_max_angle[5] = {
     TOP_SENSOR_SERVO_MAX
 };
 
-/// Initialization of array holding the current angle of the servos.
+/// Initialization of array holding the start angle of the servos.
 /// Assumes startup states to be implemented. That's why not all values are == 0.
-static int16_t servo_angle[5] = {
+static const int16_t servo_start_angle[5] = {
     41,  // Lifting arm servo
     42,  // Bucket rotation servo
     41,  // Catapult arm servo
@@ -72,12 +113,64 @@ static int16_t servo_angle[5] = {
     -15  // Top sensor servo
 };
 
+/// Memory of the servos for a run.
+typedef struct {
+    /// Current angle of the servos.
+    int16_t angle[5];
+    
+    /// Variable saying if the top sensor servo rotates left.
+    bool rotate_left;
+} servo_context_t;
+
+/// The servos of the robot.
+static RUN_LOCAL servo_context_t servo_context;
+
+/// Pre-declaration of help function.
+static void servo_write(uint8_t);
+
+/************************************************************************/
+/* Clears the servos to the start of a run (at their start angles).     */
+/************************************************************************/
+void servo_clear(void)
+{
+    memcpy(servo_context.angle, servo_start_angle, sizeof(servo_start_angle));
+    
+    servo_context.rotate_left = true;
+}
+
+/************************************************************************/
+/* Initialization of the servo timers (Timer3 and Timer5).              */
+/************************************************************************/
+void servo_init(void)
+{
+    for (uint8_t i = 0; i < 5; i++) {
+        digitalWrite(servo_pin[i], LOW);
+        pinMode(servo_pin[i], OUTPUT);
+    }
+    
+    /// Fast PWM with ICRn as TOP (mode 14), 8 prescaler. All outputs disconnected.
+    TCCR3A = (1 << WGM31);
+    TCCR3B = (1 << WGM33) | (1 << WGM32) | (1 << CS31);
+    ICR3   = SERVO_TIMER_TOP;
+    
+    TCCR5A = (1 << WGM51);
+    TCCR5B = (1 << WGM53) | (1 << WGM52) | (1 << CS51);
+    ICR5   = SERVO_TIMER_TOP;
+    
+    /// Loads the pulse of the stored angles, so attaching does not move the servos.
+    for (uint8_t i = 0; i < 5; i++) {
+        servo_write(i);
+    }
+}
+
 /************************************************************************/
 /* Attach desired servo (@param _servo).                                */
 /************************************************************************/
 void servo_attach(uint8_t _servo)
 {
-    servo[_servo].attach(servo_pin[_servo]);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *servo_tccr[_servo] |= servo_com[_servo];
+    }
 }
 
 /************************************************************************/
@@ -85,7 +178,9 @@ void servo_attach(uint8_t _servo)
 /************************************************************************/
 void servo_detach(uint8_t _servo)
 {
-    servo[_servo].detach();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *servo_tccr[_servo] &= ~servo_com[_servo];
+    }
 }
 
 /************************************************************************/
@@ -94,10 +189,10 @@ void servo_detach(uint8_t _servo)
 void servo_angle_decrement(uint8_t _servo, uint8_t amount)
 {
     /// Decrements angle.
-    servo_angle[_servo] -= amount;
+    servo_context.angle[_servo] -= amount;
     
     /// Rotates the servo to desired angle.
-    servo[_servo].write(servo_angle[_servo]);
+    servo_write(_servo);
 }
 
 /************************************************************************/
@@ -106,10 +201,10 @@ void servo_angle_decrement(uint8_t _servo, uint8_t amount)
 void servo_angle_increment(uint8_t _servo, uint8_t amount)
 {
     /// Increments angle.
-    servo_angle[_servo] += amount;
+    servo_context.angle[_servo] += amount;
     
     /// Rotates the servo to desired angle.
-    servo[_servo].write(servo_angle[_servo]);    
+    servo_write(_servo);    
 }
 
 /************************************************************************/
@@ -117,7 +212,7 @@ void servo_angle_increment(uint8_t _servo, uint8_t amount)
 /************************************************************************/
 bool servo_at_min_angle(uint8_t servo)
 {
-    return (servo_angle[servo] == servo_min_angle[servo]) ? true : false;
+    return (servo_context.angle[servo] <= servo_min_angle[servo]) ? true : false;
 }
 
 /************************************************************************/
@@ -125,33 +220,31 @@ bool servo_at_min_angle(uint8_t servo)
 /************************************************************************/
 bool servo_at_max_angle(uint8_t servo)
 {
-    return (servo_angle[servo] == servo_max_angle[servo]) ? true : false;
+    return (servo_context.angle[servo] >= servo_max_angle[servo]) ? true : false;
 }
 
 /************************************************************************/
-/* Rotation of the top sensor servo.                                    */
+/* Rotation of the top sensor servo within a field of view              */
+/* (@param min_angle, @param max_angle).                                */
 /************************************************************************/
-void top_sensor_servo_rotate(void)
+void top_sensor_servo_rotate(uint8_t min_angle, uint8_t max_angle)
 {
-    static bool rotate_left = true;
+    /// Turn around at the edges of the field of view.
+    if (servo_context.rotate_left && ((servo_context.angle[TOP_SENSOR] + TOP_SENSOR_SERVO_STEP) > max_angle)) {
+        servo_context.rotate_left = false;
+    } else if (!servo_context.rotate_left && ((servo_context.angle[TOP_SENSOR] - TOP_SENSOR_SERVO_STEP) < min_angle)) {
+        servo_context.rotate_left = true;
+    }
     
     /// The top sensor servo rotates left.
-    if (rotate_left) {
+    if (servo_context.rotate_left) {
         /// Increments angle.
-        servo_angle_increment(TOP_SENSOR, 30);
-        
-        if (servo_at_max_angle(TOP_SENSOR)) {
-            rotate_left = false;
-        }
+        servo_angle_increment(TOP_SENSOR, TOP_SENSOR_SERVO_STEP);
         
     /// The top sensor servo rotates right.
     } else {
         /// Decrements angle.
-        servo_angle_decrement(TOP_SENSOR, 30);
-        
-        if (servo_at_min_angle(TOP_SENSOR)) {
-            rotate_left = true;
-        }
+        servo_angle_decrement(TOP_SENSOR, TOP_SENSOR_SERVO_STEP);
     }
 }
 
@@ -160,7 +253,10 @@ void top_sensor_servo_rotate(void)
 /************************************************************************/
 void top_sensor_servo_mid(void)
 {
-    servo[TOP_SENSOR].write(TOP_SENSOR_SERVO_MIN + ((TOP_SENSOR_SERVO_MAX - TOP_SENSOR_SERVO_MIN) / 2));
+    /// Keeps track of the angle, so readings are stored at the right sweep position.
+    servo_context.angle[TOP_SENSOR] = TOP_SENSOR_SERVO_MIN + ((TOP_SENSOR_SERVO_MAX - TOP_SENSOR_SERVO_MIN) / 2);
+    
+    servo_write(TOP_SENSOR);
 }
 
 /************************************************************************/
@@ -168,7 +264,7 @@ void top_sensor_servo_mid(void)
 /************************************************************************/
 bool top_servo_at_mid(void)
 {
-    return (servo_angle[TOP_SENSOR] == (TOP_SENSOR_SERVO_MIN + ((TOP_SENSOR_SERVO_MAX - TOP_SENSOR_SERVO_MIN) / 2))) ? true : false;
+    return (servo_context.angle[TOP_SENSOR] == (TOP_SENSOR_SERVO_MIN + ((TOP_SENSOR_SERVO_MAX - TOP_SENSOR_SERVO_MIN) / 2))) ? true : false;
 }
 
 /************************************************************************/
@@ -176,5 +272,30 @@ bool top_servo_at_mid(void)
 /************************************************************************/
 bool top_servo_right_angle(void)
 {
-    return (servo_angle[TOP_SENSOR] <= ((TOP_SENSOR_SERVO_MAX - TOP_SENSOR_SERVO_MIN) / 2)) ? true : false;
+    return (servo_context.angle[TOP_SENSOR] <= ((TOP_SENSOR_SERVO_MAX - TOP_SENSOR_SERVO_MIN) / 2)) ? true : false;
+}
+
+/************************************************************************/
+/* @returns the current angle of the top sensor servo.                  */
+/************************************************************************/
+int16_t top_servo_angle(void)
+{
+    return servo_context.angle[TOP_SENSOR];
+}
+
+/************************************************************************/
+/* Help function to load the pulse width of the current angle of one    */
+/* servo (@param _servo). Takes effect at the start of the next period. */
+/************************************************************************/
+static void servo_write(uint8_t _servo)
+{
+    /// Angles outside 0-180 are limited, as with the Servo library.
+    int16_t angle = constrain(servo_context.angle[_servo], (int16_t) 0, (int16_t) 180);
+    
+    uint16_t pulse = SERVO_MIN_PULSE + (uint16_t) (((uint32_t) angle * (SERVO_MAX_PULSE - SERVO_MIN_PULSE)) / 180);
+    
+    /// 16 bit registers share one temporary register - no interrupt in between.
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *servo_ocr[_servo] = pulse * SERVO_COUNTS_PER_US;
+    }
 }
\ No newline at end of file
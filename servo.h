@@ -8,15 +8,18 @@
 /************************************************************************/
 /* Declaration of functions used in servo.cpp                           */
 /************************************************************************/
+void servo_clear(void);
+void servo_init(void);
 void servo_attach(uint8_t);
 void servo_detach(uint8_t);
 void servo_angle_decrement(uint8_t, uint8_t);
 void servo_angle_increment(uint8_t, uint8_t);
 bool servo_at_min_angle(uint8_t);
 bool servo_at_max_angle(uint8_t);
-void top_sensor_servo_rotate(void);
+void top_sensor_servo_rotate(uint8_t, uint8_t);
 void top_sensor_servo_mid(void);
 bool top_servo_at_mid(void);
 bool top_servo_right_angle(void);
+int16_t top_servo_angle(void);
 
 #endif
\ No newline at end of file
@@ -4,49 +4,105 @@
 
 #include "Arduino.h"
 #include "state.h"
+#include "bench.h"
 #include "compass.h"
+#include "config.h"
+#include "contact.h"
+#include "detector.h"
+#include "grid.h"
+#include "kpi.h"
+#include "magazine.h"
+#include "nav.h"
+#include "recorder.h"
 #include "robot.h"
+#include "scan.h"
 #include "sensor.h"
 #include "servo.h"
+#include "sweep.h"
+#include "timer.h"
 #include "wheel.h"
 
-/// Time before a ball triggers the system (in 10 ms resolution, so 100 => 1 second delay).
-#define BUCKET_SENSOR_TRIG_TIME  30
+/// Context of the robot run by the main loop (reset by state_reset()).
+static RUN_LOCAL state_context_t robot_context;
 
-/// Delay until the lifting arm moves down (10 ms resolution).
-#define LIFTING_ARM_DELAY_TIME  100
+/// Phases of the compass calibration state.
+#define CALIBRATION_SPIN    0
+#define CALIBRATION_VERIFY  1
+#define CALIBRATION_RETURN  2
 
-/// Delay time for the robot to go back before it makes a turn (10 ms resolution).
-#define GO_BACK_DELAY_TIME  75
+/// Delay after leaving calibration mode before the headings are trusted (ms).
+#define CALIBRATION_SETTLE_TIME  250
 
-/// Delay time for the robot to make a turn (10 ms resolution).
-#define MAKE_TURN_DELAY_TIME  125
+/// Time between two angle steps of a moving servo (ms).
+/// The angle steps of the handlers are tuned for this.
+#define SERVO_STEP_TIME  10
 
-/// Time before a compass heading search is considered timed out (10 ms resolution).
-#define COMPASS_TIME_OUT  1000
+/// Time budget of a state (ticks, 0 for none) and the state to recover to when it is spent.
+typedef struct {
+    uint16_t ticks;
+    int8_t recovery;
+} state_budget_t;
 
-/// Time to delay next compass heading search (10 ms resolution).
-/// This delay might be delayed itself if the robot picks up a ball or has to turn for wall.
-#define TURN_TO_MID_WALL_DELAY  600
+/// Time budgets of the states, in the order of STATE_INDEX().
+/// Per thread on the host, where the tuner sets the delays of each run (tuner.h).
+static RUN_LOCAL const state_budget_t state_budgets[STATE_COUNT] = {
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), BUCKET_HOME},            // LIFTING_ARM_HOME (-4)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), CATAPULT_ARM_HOME},      // BUCKET_HOME (-3)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), CATAPULT_LOCKING_HOME},  // CATAPULT_ARM_HOME (-2)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), _DEFAULT},               // CATAPULT_LOCKING_HOME (-1)
+    {0, _DEFAULT},                                                  // _DEFAULT (0)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), BUCKET_OUT},             // BUCKET_IN (1)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME + LIFTING_ARM_DELAY_TIME), LIFTING_ARM_DOWN},  // LIFTING_ARM_UP (2)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), BUCKET_OUT},             // LIFTING_ARM_DOWN (3)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), _DEFAULT},               // BUCKET_OUT (4)
+    {MS_TO_TICKS(GO_BACK_DELAY_TIME + COMPASS_TIME_OUT + STATE_BUDGET_MARGIN), _DEFAULT},      // TURN_TO_MID_WALL (5)
+    {MS_TO_TICKS(GO_BACK_DELAY_TIME + MAKE_TURN_DELAY_TIME + STATE_BUDGET_MARGIN), _DEFAULT},  // TURN_FOR_WALL (6)
+    {MS_TO_TICKS(GO_BACK_DELAY_TIME + COMPASS_TIME_OUT + MAKE_TURN_DELAY_TIME + STATE_BUDGET_MARGIN), _DEFAULT},  // TURN_TO_LAUNCH (7)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), CATAPULT_UNLOCK},        // CATAPULT_LOCK (8)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), CATAPULT_UNLOCK},        // CATAPULT_ARM_UP (9)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), CATAPULT_ARM_DOWN},      // CATAPULT_UNLOCK (10)
+    {MS_TO_TICKS(STATE_BUDGET_SERVO_TIME), _DEFAULT},               // CATAPULT_ARM_DOWN (11)
+    {MS_TO_TICKS(COMPASS_CALIBRATION_TIME + 2UL * COMPASS_TIME_OUT + STATE_BUDGET_MARGIN), _DEFAULT}  // COMPASS_CALIBRATION (12)
+};
 
-/// Maximum value of bucket trigger signals before the robot desides to turn for wall.
-#define BACK_AWAY_TRIG_COUNT  3
+/// Range (cm) of the top sensor while the robot may drive during a pickup.
+#define PICKUP_TOP_RANGE  ((PICKUP_SPEED != 0) ? TOP_SENSOR_RANGE : 0)
 
-/// Variable holding the current state of the robot.
-static volatile int8_t state = INT8_MAX;
+/// Ranges (cm) of the bucket and top sensor in each state, in the order of STATE_INDEX().
+/// Sensors the state doesn't use are off (0), so no ping takes time from the state.
+/// Per thread on the host, where the tuner sets the trigger distances of each run.
+static RUN_LOCAL const uint8_t state_sonar_ranges[STATE_COUNT][SONAR_COUNT] = {
+    {0, 0},                                    // LIFTING_ARM_HOME (-4)
+    {0, 0},                                    // BUCKET_HOME (-3)
+    {0, 0},                                    // CATAPULT_ARM_HOME (-2)
+    {0, 0},                                    // CATAPULT_LOCKING_HOME (-1)
+    {BUCKET_SENSOR_RANGE, TOP_SENSOR_RANGE},   // _DEFAULT (0)
+    {BUCKET_SENSOR_RANGE, PICKUP_TOP_RANGE},   // BUCKET_IN (1)
+    {0, PICKUP_TOP_RANGE},                     // LIFTING_ARM_UP (2)
+    {0, PICKUP_TOP_RANGE},                     // LIFTING_ARM_DOWN (3)
+    {0, PICKUP_TOP_RANGE},                     // BUCKET_OUT (4)
+    {0, 0},                                    // TURN_TO_MID_WALL (5)
+    {0, 0},                                    // TURN_FOR_WALL (6)
+    {0, 0},                                    // TURN_TO_LAUNCH (7)
+    {0, 0},                                    // CATAPULT_LOCK (8)
+    {0, 0},                                    // CATAPULT_ARM_UP (9)
+    {0, 0},                                    // CATAPULT_UNLOCK (10)
+    {0, 0},                                    // CATAPULT_ARM_DOWN (11)
+    {0, 0}                                     // COMPASS_CALIBRATION (12)
+};
 
-/// Variables holding information of the number of balls (if any) that can be launched.
-static volatile bool got_second_ball    = false;
-static volatile bool prepared_to_launch = false;
-
-/// Variable saying what way to turn.
-static volatile bool turn_left = false;
-
-/// Variable saying if the robot is trying to find the mid wall.
-static volatile bool searching_for_mid_wall = false;
-
-/// Pre-declaration of help function.
-void next_state(int8_t);
+/// Pre-declaration of help functions.
+void next_state(state_context_t *, int8_t);
+static void state_recover(state_context_t *, int8_t);
+static void start_compass_calibration(state_context_t *);
+static void start_turn_to_mid_wall(state_context_t *);
+static void start_launch(state_context_t *, bool);
+static void start_turn_for_wall(state_context_t *);
+static void turn_in_place(int8_t);
+static uint8_t cruise_speed(bool);
+static uint8_t wall_turn_side(void);
+static bool servo_step_due(state_context_t *);
+static void pickup_drive(state_context_t *);
 
 /************************************************************************/
 /* Initialization of state management.                                  */
@@ -54,127 +110,250 @@ void next_state(int8_t);
 void state_init(void)
 {
     /// Setting first state.
-    next_state(LIFTING_ARM_HOME);
+    next_state(&robot_context, LIFTING_ARM_HOME);
 }
 
 /************************************************************************/
-/* Default state (state 0).                                             */
+/* Resets a context (@param ctx) and every module to the start of a     */
+/* run, before the first state. Called before the modules are           */
+/* initialized, which then set up the hardware.                         */
 /************************************************************************/
-void default_state(void) 
+void state_reset(state_context_t *ctx)
 {
-    /// Counter variables for trigger check.
-    static uint8_t bucket_sensor_trig_counter = 0;
-    static uint8_t delay_counter = 0;
+    timer_clear();
+    recorder_clear();
+    compass_clear();
+    servo_clear();
+    wheel_clear();
+    sonar_clear();
+    sweep_clear();
+    scan_clear();
+    contact_clear();
+    nav_clear();
+    grid_clear();
+    detector_clear();
+    magazine_clear();
+    kpi_clear();
     
-    /// Logic variable for trigger check.
-    static bool triggered = false;
+    memset(ctx, 0, sizeof(state_context_t));
     
-    /// Logic variables to ensure that the most important state is up next.
-    bool pick_up_ball  = false;
-    bool turn_for_wall = false;
+    ctx->state = INT8_MAX;
+    ctx->mid_wall_go_back = true;
+    ctx->wall_go_back = true;
+    ctx->launch_go_back = true;
+    ctx->calibration_phase = CALIBRATION_SPIN;
+}
+
+/************************************************************************/
+/* @returns the context of the robot run by the main loop.              */
+/************************************************************************/
+state_context_t *state_context(void)
+{
+    return &robot_context;
+}
+
+/************************************************************************/
+/* Checks the time budget of the current state of a context             */
+/* (@param ctx) and recovers when it is spent. Called every tick before */
+/* the state handler.                                                   */
+/************************************************************************/
+void state_budget_tick(state_context_t *ctx)
+{
+    if ((ctx->state < LIFTING_ARM_HOME) || (ctx->state > COMPASS_CALIBRATION)) {
+        return;
+    }
     
-    /// Counter variable for search for mid wall delay.
-    static uint16_t mid_wall_counter = 0;
+    const state_budget_t *budget = &state_budgets[STATE_INDEX(ctx->state)];
     
-    /// Variable for counting bucket trigger signals when close to a wall.
-    /// This variable helps delay the time to turn for wall in case of ball in sight.
-    static uint8_t back_away_counter = 0;
+    /// No budget.
+    if (budget->ticks == 0) {
+        return;
+    }
     
-    /// Variable holding the direction of the top sensor servo.
-    uint8_t val = MID;
+    if (timer_expired(&ctx->dwell_timer, budget->ticks)) {
+        state_recover(ctx, budget->recovery);
+    }
+}
+
+/************************************************************************/
+/* @returns the number of times a state (@param _state) ran out of its  */
+/* time budget.                                                         */
+/************************************************************************/
+uint8_t state_overruns(int8_t _state)
+{
+    return robot_context.overruns[STATE_INDEX(_state)];
+}
+
+/************************************************************************/
+/* Compass calibration (state 12).                                      */
+/*                                                                      */
+/* Spins the robot in place with the compass in calibration mode, then  */
+/* verifies that the headings cover all four quadrants and turns back   */
+/* to the heading the robot had before the calibration. There the start */
+/* heading is taken again, so it is in the calibrated headings too.     */
+/************************************************************************/
+void compass_calibration_state(state_context_t *ctx)
+{
+    /// Variable saying if the robot should move on to next state or not.
+    bool move_on = false;
     
-    /// The robot has less than two balls.
-    if (!got_second_ball) {
-        /// Bucket trigger check to make sure there is ball to pick up.
-        /**************************************************************/
-        
-        /// Trigger delay.
-        if (triggered) {
-            delay_counter++;
-        
-            if (delay_counter == (BUCKET_SENSOR_TRIG_TIME / 2)) {
-                delay_counter = 0;
-                triggered = false;
+    switch (ctx->calibration_phase) {
+        /// Spin with the compass in calibration mode.
+        case CALIBRATION_SPIN :
+            if (!timer_after(&ctx->calibration_timer, 0)) {
+                ctx->calibration_heading = compass_heading();
+                ctx->calibration_offset  = compass_offset();
+                
+                compass_calibration(true);
+            }
+            
+            if (timer_expired(&ctx->calibration_timer, MS_TO_TICKS(COMPASS_CALIBRATION_TIME))) {
+                ctx->calibration_quadrants = 0;
+                ctx->calibration_phase = CALIBRATION_VERIFY;
+                
+                compass_calibration(false);
             }
+            break;
             
-        /// Checking bucket sensor.
-        } else if (bucket_sensor_triggered()) {
-            bucket_sensor_trig_counter++;
-            triggered = true;
+        /// Keep spinning until the headings have covered the full circle.
+        case CALIBRATION_VERIFY :
+            if (timer_after(&ctx->calibration_timer, MS_TO_TICKS(CALIBRATION_SETTLE_TIME))) {
+                ctx->calibration_quadrants |= 1 << (((compass_heading() + 180) / 90) & 3);
+            }
             
-        /// Resetting counter.
-        } else {
-            bucket_sensor_trig_counter = 0;
+            /// Calibration is OK.
+            if (ctx->calibration_quadrants == 0x0F) {
+                timer_reset(&ctx->calibration_timer);
+                ctx->calibration_phase = CALIBRATION_RETURN;
+                
+                Serial.println(F("Compass calibration OK"));
+                
+            /// Verification timed out.
+            } else if (timer_expired(&ctx->calibration_timer, MS_TO_TICKS(COMPASS_TIME_OUT))) {
+                ctx->calibration_phase = CALIBRATION_RETURN;
+                
+                Serial.print(F("Compass calibration failed, quadrants: "));
+                Serial.println(ctx->calibration_quadrants, HEX);
+            }
+            break;
             
-            wheel_toggle_brake(BOTH, OFF);
-        }
+        /// Turn back to the heading before the calibration.
+        case CALIBRATION_RETURN :
+            /// Back where the calibration started - take the start heading again
+            /// with the calibrated headings, keeping the offset from before.
+            if (compass_heading_near(ctx->calibration_heading)) {
+                compass_set_start(ctx->calibration_offset);
+                
+                move_on = true;
+                
+            /// The old start heading is kept.
+            } else if (timer_expired(&ctx->calibration_timer, MS_TO_TICKS(COMPASS_TIME_OUT))) {
+                Serial.println(F("Compass calibration return timed out"));
+                
+                move_on = true;
+            }
+            break;
+    }
+    
+    /// Move on to next state.
+    if (move_on) {
+        timer_reset(&ctx->calibration_timer);
+        ctx->calibration_phase = CALIBRATION_SPIN;
+        
+        /// Stop turning.
+        wheel_set_direction(BOTH, FORWARD);
+        
+        /// High Speed Mode.
+        wheel_set_speed(HIGH);
+        
+        next_state(ctx, _DEFAULT);
+    }
+}
+
+/************************************************************************/
+/* Requests a compass calibration, started from the default state.      */
+/************************************************************************/
+void request_compass_calibration(void)
+{
+    robot_context.calibration_requested = true;
+}
+
+/************************************************************************/
+/* Default state (state 0).                                             */
+/************************************************************************/
+void default_state(state_context_t *ctx)
+{
+    /// Logic variables to ensure that the most important state is up next.
+    bool pick_up_ball  = false;
+    bool turn_for_wall = false;
+    
+    /// Variable saying if there might be a ball in front of the robot.
+    bool ball_in_sight = false;
+    
+    /// A compass calibration is requested.
+    if (ctx->calibration_requested) {
+        start_compass_calibration(ctx);
+        return;
+    }
+    
+    /// The magazine has room for another ball.
+    if (!magazine_full()) {
+        /// Ball detector check to make sure there is ball to pick up.
+        /*************************************************************/
         
         /// A ball will be picked up.
-        if (bucket_sensor_trig_counter == 3) {
-            bucket_sensor_trig_counter = 0;
-            
-            /// Setting logic variables.
-            triggered = false;
+        if (detector_ball()) {
+            /// Setting logic variable.
             pick_up_ball = true;
             
-            /// Stop the robot.            
-            wheel_toggle_brake(BOTH, ON);
+            /// Starts a new pickup.
+            ctx->pickup_stopped = false;
             
-            next_state(BUCKET_IN);
+            next_state(ctx, BUCKET_IN);
+            
+            /// Hold the robot until the catch is confirmed.
+            pickup_drive(ctx);
+            
+        /// There might be a ball.
+        } else if (detector_evidence()) {
+            ball_in_sight = true;
+            
+        /// No sign of a ball.
+        } else {
+            wheel_toggle_brake(BOTH, OFF);
         }
     }
     
-    /// Checking the direction of the top sensor servo.
-    if (!top_servo_at_mid()) {
-        val = SIDE;
+    /// The robot has reached the launch distance in front of the mid wall.
+    /**************************************************************/
+    if (ctx->going_to_launch && !ctx->searching_for_mid_wall && nav_at_launch_distance() && !pick_up_ball) {
+        start_launch(ctx, false);
+        return;
     }
     
-    /// Checking if the robot is too close to a wall.
-    /************************************************/
-    if (top_sensor_triggered(val) && !pick_up_ball) {
-        /// The robot has one or two balls.
-        if (prepared_to_launch && !searching_for_mid_wall) {
-            prepared_to_launch = false;
+    /// Checking if the robot can still stop in front of a wall.
+    /************************************************************/
+    if (contact_predicted() && !pick_up_ball) {
+        /// The robot is at the mid wall with balls to launch.
+        if (ctx->going_to_launch && !ctx->searching_for_mid_wall) {
+            nav_at_mid_wall();
             
-            /// Low Speed Mode for turning.
-            wheel_set_speed(LOW);
-            
-            /// Prepare to move backwards.
-            wheel_set_direction(BOTH, BACKWARD);
-            
-            next_state(TURN_TO_LAUNCH);
+            /// Too close to turn - move backwards first.
+            start_launch(ctx, true);
             
         /// The robot has no ball.
         } else {
             /// No ball in front of the robot.
-            if ((bucket_sensor_trig_counter == 0) || (back_away_counter == BACK_AWAY_TRIG_COUNT)) {
-                /// Resets the counter for trigger signals close to a wall.
-                back_away_counter = 0;
-                
+            if (!ball_in_sight || (ctx->back_away_counter == BACK_AWAY_TRIG_COUNT)) {
                 /// Sets logic variable to prevent another change of state.
                 turn_for_wall = true;
                 
-                /// Low Speed Mode for turning.
-                wheel_set_speed(LOW);
-                
-                /// Wall on the right.
-                if (top_servo_right_angle()) {
-                    /// Turn left.
-                    turn_left = true;
-                }
-                
-                /// Prepare to move backwards.
-                wheel_set_direction(BOTH, BACKWARD);
-                
-                /// Let go of the robot.
-                wheel_toggle_brake(BOTH, OFF);
-                
-                next_state(TURN_FOR_WALL);
+                start_turn_for_wall(ctx);
                 
             /// There might be a ball to pick up.
             } else {
                 /// Increments the counter for trigger signals close to a wall.
-                back_away_counter++;
+                ctx->back_away_counter++;
                 
                 /// Stop the robot.
                 wheel_toggle_brake(BOTH, ON);
@@ -183,25 +362,26 @@ void default_state(void)
         }
     }
     
+    /// Scales the driving speed with the free space ahead.
+    /*******************************************************/
+    if (!pick_up_ball && !turn_for_wall) {
+        wheel_set_target(BOTH, cruise_speed(ball_in_sight));
+    }
+    
+    /// The held balls are ready to be launched - look for mid wall.
+    /*****************************************************************/
+    if (!ctx->going_to_launch && !ctx->launching && magazine_ready() && !pick_up_ball && !turn_for_wall) {
+        start_turn_to_mid_wall(ctx);
+        return;
+    }
+    
     /// Waiting to try to find the mid wall once again.
     /**************************************************/
-    if (searching_for_mid_wall && !pick_up_ball && !turn_for_wall) {        
-        mid_wall_counter++;
-        
-        if (mid_wall_counter == TURN_TO_MID_WALL_DELAY) {
-            mid_wall_counter = 0;
-            searching_for_mid_wall = false;
-            
-            /// Low Speed Mode for turning.
-            wheel_set_speed(LOW);
-                
-            /// Turn left.
-            wheel_set_direction(LEFT, BACKWARD);
-                
-            /// Let go of the robot.
-            wheel_toggle_brake(BOTH, OFF);
+    if (ctx->searching_for_mid_wall && !pick_up_ball && !turn_for_wall) {        
+        if (timer_expired(&ctx->mid_wall_timer, MS_TO_TICKS(TURN_TO_MID_WALL_DELAY))) {
+            ctx->searching_for_mid_wall = false;
             
-            next_state(TURN_TO_MID_WALL);
+            start_turn_to_mid_wall(ctx);
         }
     }
 }
@@ -209,33 +389,44 @@ void default_state(void)
 /************************************************************************/
 /* Rotate the bucket rotation servo IN (states 1).                      */
 /************************************************************************/
-void bucket_in(void)
+void bucket_in(state_context_t *ctx)
 {
+    /// Holds the robot while the bucket moves.
+    pickup_drive(ctx);
+    
+    /// Waits for the next servo step.
+    if (!servo_step_due(ctx)) {
+        return;
+    }
+    
     /// Increments servo angle.
     servo_angle_increment(BUCKET_ROTATION, 4);
     
     /// The servo is at max angle.
     if (servo_at_max_angle(BUCKET_ROTATION)) {
         /// Double-check if there is a ball.
-        if (bucket_sensor_triggered()) {
-            /// The robot has no ball from before.
-            if (!prepared_to_launch) {
-                prepared_to_launch = true;
-                
-                next_state(LIFTING_ARM_UP);
+        if (sonar_triggered(BUCKET_SONAR, MID)) {
+            magazine_catch();
+            kpi_event(KPI_BALLS_CAUGHT);
             
-            /// The robot has one ball from before.
-            } else {
-                got_second_ball = true;
+            /// The catapult is empty - load the ball.
+            if (!magazine_loaded()) {
+                next_state(ctx, LIFTING_ARM_UP);
+            
+            /// The catapult is loaded, a wall is ahead - keep the ball in the bucket and turn.
+            } else if (ctx->pickup_stopped) {
+                start_turn_for_wall(ctx);
                 
+            /// The catapult is loaded - keep the ball in the bucket.
+            } else {
                 /// Let go of the robot.
                 wheel_toggle_brake(BOTH, OFF);
                 
-                next_state(_DEFAULT);
+                next_state(ctx, _DEFAULT);
             }
         /// There is no ball. 
         } else {
-            next_state(BUCKET_OUT);
+            next_state(ctx, BUCKET_OUT);
         }
     }
 }
@@ -243,44 +434,45 @@ void bucket_in(void)
 /************************************************************************/
 /* Rotate the bucket rotation servo OUT (states -3, 4).                 */
 /************************************************************************/
-void bucket_out(void)
+void bucket_out(state_context_t *ctx)
 {
+    /// Keeps driving while the bucket moves.
+    pickup_drive(ctx);
+    
+    /// Waits for the next servo step.
+    if (!servo_step_due(ctx)) {
+        return;
+    }
+    
     /// Decrements servo angle.
     servo_angle_decrement(BUCKET_ROTATION, 2);
     
     /// The servo is at min angle.
     if (servo_at_min_angle(BUCKET_ROTATION)) {
         /// Startup state.
-        if (state == BUCKET_HOME) {
-            next_state(CATAPULT_ARM_HOME);
+        if (ctx->state == BUCKET_HOME) {
+            next_state(ctx, CATAPULT_ARM_HOME);
             
         /// Regular state.
-        } else if (state == BUCKET_OUT) {
-            /// The robot had two balls and will launch again.
-            if (got_second_ball) {
-                got_second_ball = false;
-                
-                next_state(CATAPULT_LOCK);
-                
-            /// One ball is picked up - look for mid wall.
-            } else if (prepared_to_launch) {
-                /// Low Speed Mode for turning.
-                wheel_set_speed(LOW);
-                
-                /// Prepare the robot to move backwards.
-                wheel_set_direction(BOTH, BACKWARD);
+        } else if (ctx->state == BUCKET_OUT) {
+            /// The catapult is reloaded - launch the next ball.
+            if (ctx->launching) {
+                next_state(ctx, CATAPULT_LOCK);
                 
-                /// Let go of the robot.
-                wheel_toggle_brake(BOTH, OFF);
+            /// Enough balls are picked up - look for mid wall.
+            } else if (magazine_ready() && !ctx->going_to_launch) {
+                start_turn_to_mid_wall(ctx);
                 
-                next_state(TURN_TO_MID_WALL);
+            /// The robot stopped for a wall during the pickup.
+            } else if (ctx->pickup_stopped) {
+                start_turn_for_wall(ctx);
                 
-            /// There is no ball.
+            /// Carry on.
             } else {
                 /// Let go of the robot.
                 wheel_toggle_brake(BOTH, OFF);
                 
-                next_state(_DEFAULT);
+                next_state(ctx, _DEFAULT);
             }
         }
     }
@@ -289,24 +481,25 @@ void bucket_out(void)
 /************************************************************************/
 /* Move the lifting arm UP (state 2).                                   */
 /************************************************************************/
-void lifting_arm_up(void)
+void lifting_arm_up(state_context_t *ctx)
 {
-    /// Delay counter variable.
-    static uint8_t delay_counter = 0;    
+    /// Keeps driving while the lifting arm moves.
+    pickup_drive(ctx);
     
     /// The servo is not at max angle.
     if (!servo_at_max_angle(LIFTING_ARM)) {
         /// Increments servo angle.
-        servo_angle_increment(LIFTING_ARM, 2);
+        if (servo_step_due(ctx)) {
+            servo_angle_increment(LIFTING_ARM, 2);
+        }
         
     /// The servo is at max angle - delay the down movement.
     } else {
-        delay_counter++;
-        
-        if (delay_counter == LIFTING_ARM_DELAY_TIME) {
-            delay_counter = 0;
+        if (timer_expired(&ctx->arm_delay_timer, MS_TO_TICKS(LIFTING_ARM_DELAY_TIME))) {
+            /// The ball is in the catapult.
+            magazine_load();
             
-            next_state(LIFTING_ARM_DOWN);
+            next_state(ctx, LIFTING_ARM_DOWN);
         }
     }
 }
@@ -314,20 +507,28 @@ void lifting_arm_up(void)
 /************************************************************************/
 /* Move the lifting arm DOWN (states -4, 3).                            */
 /************************************************************************/
-void lifting_arm_down(void)
+void lifting_arm_down(state_context_t *ctx)
 {
+    /// Keeps driving while the lifting arm moves.
+    pickup_drive(ctx);
+    
+    /// Waits for the next servo step.
+    if (!servo_step_due(ctx)) {
+        return;
+    }
+    
     /// Decrements servo angle.
     servo_angle_decrement(LIFTING_ARM, 1);
     
     /// The servo is at min angle.
     if (servo_at_min_angle(LIFTING_ARM)) {
         /// Startup state.
-        if (state == LIFTING_ARM_HOME) {
-            next_state(BUCKET_HOME);
+        if (ctx->state == LIFTING_ARM_HOME) {
+            next_state(ctx, BUCKET_HOME);
             
         /// Regular state.
-        } else if (state == LIFTING_ARM_DOWN) {
-            next_state(BUCKET_OUT);
+        } else if (ctx->state == LIFTING_ARM_DOWN) {
+            next_state(ctx, BUCKET_OUT);
         }
     }
 }
@@ -335,50 +536,44 @@ void lifting_arm_down(void)
 /************************************************************************/
 /* Turn to mid wall (state 5).                                          */
 /************************************************************************/
-void turn_to_mid_wall(void)
+void turn_to_mid_wall(state_context_t *ctx)
 {
-    /// Delay counter for moving backwards.
-    static uint16_t go_back_counter = 0;
-    
-    /// Variable saying if the robot should move backwards or not.
-    static bool go_back = true;
-    
-    /// Time out counter.
-    static uint16_t time_out = 0;
-    
     /// Variable saying if the robot should move on to next state or not.
     bool move_on = false;
     
     /// Move backwards.
-    if (go_back) {
-        go_back_counter++;
-        
-        if (go_back_counter == GO_BACK_DELAY_TIME) {
-            go_back_counter = 0;
-            go_back = false;
+    if (ctx->mid_wall_go_back) {
+        if (timer_expired(&ctx->mid_wall_go_back_timer, MS_TO_TICKS(GO_BACK_DELAY_TIME))) {
+            ctx->mid_wall_go_back = false;
             
-            /// Turn left.
-            wheel_set_direction(RIGHT, FORWARD);
+            /// Turn the shortest way to the planned heading.
+            turn_in_place(compass_target_turn());
         }
         
     /// Turn around.
     } else {
-        time_out++;
-    
         /// Compass heading is OK.
         if (compass_heading_ok()) {
+            /// Launch from here instead of driving to the mid wall.
+            if (MAGAZINE_LAUNCH_WHEN_ALIGNED) {
+                timer_reset(&ctx->mid_wall_time_out_timer);
+                
+                start_launch(ctx, false);
+                return;
+            }
+            
             move_on = true;        
         
         /// Searching for compass heading timed out.
-        } else if (time_out == COMPASS_TIME_OUT) {
-            searching_for_mid_wall = true;
+        } else if (timer_expired(&ctx->mid_wall_time_out_timer, MS_TO_TICKS(COMPASS_TIME_OUT))) {
+            ctx->searching_for_mid_wall = true;
+            kpi_event(KPI_COMPASS_TIMEOUTS);
             move_on = true;
         }
         
         /// Move on to next state.
         if (move_on) {
-            time_out = 0;
-            go_back = true;
+            timer_reset(&ctx->mid_wall_time_out_timer);
         
             /// Stop turning.
             wheel_set_direction(BOTH, FORWARD);
@@ -386,7 +581,7 @@ void turn_to_mid_wall(void)
             /// High Speed Mode.
             wheel_set_speed(HIGH);
         
-            next_state(_DEFAULT);
+            next_state(ctx, _DEFAULT);
         }
     }    
 }
@@ -394,26 +589,16 @@ void turn_to_mid_wall(void)
 /************************************************************************/
 /* Turn for wall (state 6).                                             */
 /************************************************************************/
-void turn_for_wall(void)
+void turn_for_wall(state_context_t *ctx)
 {
-    /// Delay counter variables.
-    static uint8_t delay_counter = 0;
-    static uint16_t go_back_counter = 0;
-    
-    /// Variable saying if the robot should move backwards or not.
-    static bool go_back = true;    
-    
     /// Move backwards.
-    if (go_back) {
-        go_back_counter++;
-        
-        if (go_back_counter == GO_BACK_DELAY_TIME) {
-            go_back_counter = 0;
-            go_back = false;
+    if (ctx->wall_go_back) {
+        if (timer_expired(&ctx->wall_go_back_timer, MS_TO_TICKS(GO_BACK_DELAY_TIME))) {
+            ctx->wall_go_back = false;
             
             /// Turn left.
-            if (turn_left) {
-                turn_left = false;
+            if (ctx->turn_left) {
+                ctx->turn_left = false;
                 
                 wheel_set_direction(RIGHT, FORWARD);
                 
@@ -426,12 +611,9 @@ void turn_for_wall(void)
         
     /// Turn around.
     } else {
-        delay_counter++;
-        
         /// Turn is done.
-        if (delay_counter == MAKE_TURN_DELAY_TIME) {
-            delay_counter = 0;
-            go_back = true;
+        if (timer_expired(&ctx->wall_turn_timer, MS_TO_TICKS(MAKE_TURN_DELAY_TIME))) {
+            ctx->wall_go_back = true;
         
             /// Stop turning.
             wheel_set_direction(BOTH, FORWARD); 
@@ -439,7 +621,7 @@ void turn_for_wall(void)
             /// High Speed Mode.
             wheel_set_speed(HIGH);
         
-            next_state(_DEFAULT);
+            next_state(ctx, _DEFAULT);
         }
     }    
 }
@@ -447,35 +629,34 @@ void turn_for_wall(void)
 /************************************************************************/
 /* Turn to launch (state 7).                                            */
 /************************************************************************/
-void turn_to_launch(void)
+void turn_to_launch(state_context_t *ctx)
 {
-    /// Delay counter variables.
-    static uint8_t delay_counter = 0;
-    static uint16_t go_back_counter = 0;
-    
-    /// Variable saying if the robot should move backwards or not.
-    static bool go_back = true;
-    
     /// Move backwards.
-    if (go_back) {
-        go_back_counter++;
-        
-        if (go_back_counter == GO_BACK_DELAY_TIME) {
-            go_back_counter = 0;
-            go_back = false;
+    if (ctx->launch_go_back) {
+        if (timer_expired(&ctx->launch_go_back_timer, MS_TO_TICKS(GO_BACK_DELAY_TIME))) {
+            ctx->launch_go_back = false;
+            
+            /// Turn the shortest way to the start heading.
+            turn_in_place(compass_target_turn());
+        }
+    
+    /// Turn to the start heading, so the timed turn starts square to the mid wall.
+    } else if (!ctx->launch_aligned) {
+        if (compass_heading_ok() || timer_expired(&ctx->launch_align_timer, MS_TO_TICKS(COMPASS_TIME_OUT))) {
+            ctx->launch_aligned = true;
+            
+            timer_reset(&ctx->launch_align_timer);
             
             /// Turn left.
-            wheel_set_direction(RIGHT, FORWARD);
+            turn_in_place(-1);
         }
     
     /// Turn around.
     } else {
-        delay_counter++;
-    
         /// Turn is done.
-        if (delay_counter == MAKE_TURN_DELAY_TIME) {
-            delay_counter = 0;
-            go_back = true;
+        if (timer_expired(&ctx->launch_turn_timer, MS_TO_TICKS(MAKE_TURN_DELAY_TIME))) {
+            ctx->launch_go_back = true;
+            ctx->launch_aligned = false;
         
             /// Stop turning.
             wheel_set_direction(BOTH, FORWARD); 
@@ -486,7 +667,7 @@ void turn_to_launch(void)
             /// Stop the robot.
             wheel_toggle_brake(BOTH, ON);
         
-            next_state(CATAPULT_LOCK);
+            next_state(ctx, CATAPULT_LOCK);
         }    
     }    
 }
@@ -494,34 +675,53 @@ void turn_to_launch(void)
 /************************************************************************/
 /* Lock the catapult (state 8).                                         */
 /************************************************************************/
-void catapult_lock(void)
+void catapult_lock(state_context_t *ctx)
 {
+    /// Waits for the next servo step.
+    if (!servo_step_due(ctx)) {
+        return;
+    }
+    
     /// Increments servo angle.
     servo_angle_increment(CATAPULT_LOCKING, 3);
     
     /// The servo is at max angle.
     if (servo_at_max_angle(CATAPULT_LOCKING)) {
-        next_state(CATAPULT_ARM_UP);
+        next_state(ctx, CATAPULT_ARM_UP);
     }
 }
 
 /************************************************************************/
 /* Unlock the catapult (states -1, 10).                                 */
 /************************************************************************/
-void catapult_unlock(void)
+void catapult_unlock(state_context_t *ctx)
 {
+    /// Waits for the next servo step.
+    if (!servo_step_due(ctx)) {
+        return;
+    }
+    
     /// Decrements servo angle.
     servo_angle_decrement(CATAPULT_LOCKING, 3);
     
     /// The servo is at min angle.
     if (servo_at_min_angle(CATAPULT_LOCKING)) {
         /// Startup state.
-        if (state == CATAPULT_LOCKING_HOME) {
-            next_state(_DEFAULT);
+        if (ctx->state == CATAPULT_LOCKING_HOME) {
+            /// Calibrate the compass before the run.
+            if (COMPASS_CALIBRATE_AT_BOOT) {
+                start_compass_calibration(ctx);
+            } else {
+                next_state(ctx, _DEFAULT);
+            }
             
         /// Regular state.
-        } else if (state == CATAPULT_UNLOCK) {
-            next_state(CATAPULT_ARM_DOWN);
+        } else if (ctx->state == CATAPULT_UNLOCK) {
+            /// The ball is launched.
+            magazine_launch();
+            kpi_event(KPI_LAUNCHES);
+            
+            next_state(ctx, CATAPULT_ARM_DOWN);
         }
     }
 }
@@ -529,43 +729,55 @@ void catapult_unlock(void)
 /************************************************************************/
 /* Move the catapult arm UP (state 9).                                  */
 /************************************************************************/
-void catapult_arm_up(void)
+void catapult_arm_up(state_context_t *ctx)
 {
+    /// Waits for the next servo step.
+    if (!servo_step_due(ctx)) {
+        return;
+    }
+    
     /// Increments servo angle.
     servo_angle_increment(CATAPULT_ARM, 1);
     
     /// The servo is at max angle.
     if (servo_at_max_angle(CATAPULT_ARM)) {
-        next_state(CATAPULT_UNLOCK);
+        next_state(ctx, CATAPULT_UNLOCK);
     }
 }
 
 /************************************************************************/
 /* Move the catapult arm DOWN (states -2, 11).                          */
 /************************************************************************/
-void catapult_arm_down(void)
+void catapult_arm_down(state_context_t *ctx)
 {
+    /// Waits for the next servo step.
+    if (!servo_step_due(ctx)) {
+        return;
+    }
+    
     /// Decrements servo angle.
     servo_angle_decrement(CATAPULT_ARM, 1);
     
     /// The servo is at min angle.
     if (servo_at_min_angle(CATAPULT_ARM)) {
         /// Startup state.
-        if (state == CATAPULT_ARM_HOME) {
-            next_state(CATAPULT_LOCKING_HOME);
+        if (ctx->state == CATAPULT_ARM_HOME) {
+            next_state(ctx, CATAPULT_LOCKING_HOME);
             
         /// Regular state.
-        } else if (state == CATAPULT_ARM_DOWN) {
+        } else if (ctx->state == CATAPULT_ARM_DOWN) {
             /// Launching is done.
-            if(!got_second_ball) {
+            if (magazine_count() == 0) {
+                ctx->launching = false;
+                
                 /// Let go of the robot.
                 wheel_toggle_brake(BOTH, OFF);
                 
-                next_state(_DEFAULT);
+                next_state(ctx, _DEFAULT);
                 
-            /// There is a second ball to launch.
+            /// There is another ball to launch - reload from the bucket.
             } else {
-                next_state(LIFTING_ARM_UP);
+                next_state(ctx, LIFTING_ARM_UP);
             }
         }
     }
@@ -578,7 +790,7 @@ bool going_for_mid_wall(void)
 {
     bool mid_wall = false;
     
-    if (prepared_to_launch && !searching_for_mid_wall) {
+    if (robot_context.going_to_launch && !robot_context.searching_for_mid_wall) {
         mid_wall = true;
     }
     
@@ -588,10 +800,13 @@ bool going_for_mid_wall(void)
 /************************************************************************/
 /* Help function to attach/detach servos and setting the next state.    */
 /************************************************************************/
-void next_state(int8_t next_state)
+void next_state(state_context_t *ctx, int8_t next_state)
 {
+    /// Start time for profiling.
+    unsigned long start = micros();
+    
     /// Current state.
-    switch (state) {
+    switch (ctx->state) {
         /// Startup states.
         /*******************/
         case LIFTING_ARM_HOME :       // (-4)
@@ -610,8 +825,8 @@ void next_state(int8_t next_state)
         /// Regular states.
         /*******************/
         case _DEFAULT :               // (0)
-            servo_detach(TOP_SENSOR);
             servo_detach(LIFTING_ARM);
+            detector_reset();
             break;
         case BUCKET_IN :              // (1)
             servo_detach(BUCKET_ROTATION);
@@ -660,7 +875,6 @@ void next_state(int8_t next_state)
         /// Regular states.
         /*******************/
         case _DEFAULT :               // (0)
-            servo_attach(TOP_SENSOR);
             servo_attach(LIFTING_ARM);
             break;
         case BUCKET_IN :              // (1)
@@ -690,7 +904,54 @@ void next_state(int8_t next_state)
             break;
     }
     
-    state = next_state;
+    /// Sets the sensor ranges of the next state.
+    for (uint8_t id = 0; id < SONAR_COUNT; id++) {
+        sonar_set_range(id, state_sonar_ranges[STATE_INDEX(next_state)][id]);
+    }
+    
+    /// The top sensor servo is only held in position while the top sensor is used.
+    if (state_sonar_ranges[STATE_INDEX(next_state)][TOP_SONAR] != 0) {
+        servo_attach(TOP_SENSOR);
+    } else {
+        servo_detach(TOP_SENSOR);
+    }
+    
+    /// Records the state transition.
+    recorder_log(RECORD_STATE, (uint8_t) ctx->state, next_state);
+    
+    ctx->state = next_state;
+    
+    /// Starts the time budget of the next state.
+    timer_reset(&ctx->dwell_timer);
+    
+    bench_profile(BENCH_NEXT_STATE, micros() - start);
+}
+
+/************************************************************************/
+/* Prints the name of a state (@param _state) over serial.              */
+/************************************************************************/
+void state_print_name(int8_t _state)
+{
+    switch (_state) {
+        case LIFTING_ARM_HOME :       Serial.print(F("LIFTING_ARM_HOME"));       break;
+        case BUCKET_HOME :            Serial.print(F("BUCKET_HOME"));            break;
+        case CATAPULT_ARM_HOME :      Serial.print(F("CATAPULT_ARM_HOME"));      break;
+        case CATAPULT_LOCKING_HOME :  Serial.print(F("CATAPULT_LOCKING_HOME"));  break;
+        case _DEFAULT :               Serial.print(F("DEFAULT"));                break;
+        case BUCKET_IN :              Serial.print(F("BUCKET_IN"));              break;
+        case LIFTING_ARM_UP :         Serial.print(F("LIFTING_ARM_UP"));         break;
+        case LIFTING_ARM_DOWN :       Serial.print(F("LIFTING_ARM_DOWN"));       break;
+        case BUCKET_OUT :             Serial.print(F("BUCKET_OUT"));             break;
+        case TURN_TO_MID_WALL :       Serial.print(F("TURN_TO_MID_WALL"));       break;
+        case TURN_FOR_WALL :          Serial.print(F("TURN_FOR_WALL"));          break;
+        case TURN_TO_LAUNCH :         Serial.print(F("TURN_TO_LAUNCH"));         break;
+        case CATAPULT_LOCK :          Serial.print(F("CATAPULT_LOCK"));          break;
+        case CATAPULT_ARM_UP :        Serial.print(F("CATAPULT_ARM_UP"));        break;
+        case CATAPULT_UNLOCK :        Serial.print(F("CATAPULT_UNLOCK"));        break;
+        case CATAPULT_ARM_DOWN :      Serial.print(F("CATAPULT_ARM_DOWN"));      break;
+        case COMPASS_CALIBRATION :    Serial.print(F("COMPASS_CALIBRATION"));    break;
+        default :                     Serial.print(_state);                       break;
+    }
 }
 
 /************************************************************************/
@@ -698,5 +959,301 @@ void next_state(int8_t next_state)
 /************************************************************************/
 int8_t current_state(void)
 {
-    return state;
+    return robot_context.state;
+}
+
+/************************************************************************/
+/* Help function to spin the robot in place and start the compass       */
+/* calibration.                                                         */
+/************************************************************************/
+static void start_compass_calibration(state_context_t *ctx)
+{
+    ctx->calibration_requested = false;
+    
+    /// Nothing to calibrate without the compass.
+    if (!compass_available()) {
+        next_state(ctx, _DEFAULT);
+        return;
+    }
+    
+    /// Low Speed Mode for turning.
+    wheel_set_speed(LOW);
+    
+    /// Turn left in place.
+    turn_in_place(-1);
+    
+    /// Let go of the robot.
+    wheel_toggle_brake(BOTH, OFF);
+    
+    next_state(ctx, COMPASS_CALIBRATION);
+}
+
+/************************************************************************/
+/* Help function to leave a state of a context (@param ctx) that ran    */
+/* out of its time budget, for the state @param recovery.               */
+/************************************************************************/
+static void state_recover(state_context_t *ctx, int8_t recovery)
+{
+    uint8_t *overruns = &ctx->overruns[STATE_INDEX(ctx->state)];
+    
+    if (*overruns < UINT8_MAX) {
+        (*overruns)++;
+    }
+    
+    kpi_event(KPI_BUDGET_OVERRUNS);
+    
+    Serial.print(F("State budget spent: "));
+    state_print_name(ctx->state);
+    Serial.println();
+    
+    /// The handlers start over the next time.
+    timer_reset(&ctx->servo_step_timer);
+    timer_reset(&ctx->calibration_timer);
+    timer_reset(&ctx->arm_delay_timer);
+    timer_reset(&ctx->mid_wall_go_back_timer);
+    timer_reset(&ctx->mid_wall_time_out_timer);
+    timer_reset(&ctx->wall_turn_timer);
+    timer_reset(&ctx->wall_go_back_timer);
+    timer_reset(&ctx->launch_turn_timer);
+    timer_reset(&ctx->launch_go_back_timer);
+    timer_reset(&ctx->launch_align_timer);
+    ctx->calibration_phase = CALIBRATION_SPIN;
+    ctx->wall_go_back = true;
+    ctx->launch_go_back = true;
+    ctx->launch_aligned = false;
+    
+    switch (ctx->state) {
+        /// Stuck calibration - back to normal headings.
+        case COMPASS_CALIBRATION :
+            compass_calibration(false);
+            break;
+            
+        /// The arm may or may not have tipped the ball into the catapult. Counted as
+        /// loaded: an empty launch costs a turn, a second ball on a loaded catapult
+        /// would jam it.
+        case LIFTING_ARM_UP :
+            magazine_load();
+            Serial.println(F("Ball load uncertain, counted as loaded"));
+            break;
+            
+        /// Try to find the mid wall again later.
+        case TURN_TO_MID_WALL :
+            ctx->searching_for_mid_wall = true;
+            break;
+            
+        /// The catapult is unlocked - the ball is gone.
+        case CATAPULT_UNLOCK :
+            magazine_launch();
+            kpi_event(KPI_LAUNCHES);
+            break;
+    }
+    
+    if (recovery == _DEFAULT) {
+        /// Launching is abandoned.
+        ctx->launching = false;
+        
+        /// Stop turning.
+        wheel_set_direction(BOTH, FORWARD);
+        
+        /// High Speed Mode.
+        wheel_set_speed(HIGH);
+        
+        /// Let go of the robot.
+        wheel_toggle_brake(BOTH, OFF);
+    }
+    
+    next_state(ctx, recovery);
+}
+
+/************************************************************************/
+/* Help function that @returns whether the moving servo is due for its  */
+/* next angle step or not. Advances the servo step timer.               */
+/************************************************************************/
+static bool servo_step_due(state_context_t *ctx)
+{
+    return timer_expired(&ctx->servo_step_timer, MS_TO_TICKS(SERVO_STEP_TIME));
+}
+
+/************************************************************************/
+/* Help function to reverse and turn towards the mid wall, to launch    */
+/* the held balls.                                                      */
+/************************************************************************/
+static void start_turn_to_mid_wall(state_context_t *ctx)
+{
+    uint8_t nearest = scan_nearest_distance();
+    
+    ctx->going_to_launch = true;
+    
+    /// Plans the heading of the straightest drive to the launch position.
+    compass_set_target(nav_launch_bearing());
+    
+    /// Low Speed Mode for turning.
+    wheel_set_speed(LOW);
+    
+    /// Enough room to turn - no need to move backwards.
+    if ((nearest != SCAN_UNKNOWN) && (nearest > NAV_TURN_CLEARANCE)) {
+        ctx->mid_wall_go_back = false;
+        
+        turn_in_place(compass_target_turn());
+        
+    /// Prepare the robot to move backwards.
+    } else {
+        ctx->mid_wall_go_back = true;
+        
+        wheel_set_direction(BOTH, BACKWARD);
+    }
+    
+    /// Let go of the robot.
+    wheel_toggle_brake(BOTH, OFF);
+    
+    next_state(ctx, TURN_TO_MID_WALL);
+}
+
+/************************************************************************/
+/* Help function to turn into launch position and launch all held balls */
+/* back-to-back. The robot moves backwards first (@param go_back) and   */
+/* turns back to the start heading before the timed turn.               */
+/************************************************************************/
+static void start_launch(state_context_t *ctx, bool go_back)
+{
+    ctx->going_to_launch = false;
+    ctx->launching = true;
+    ctx->launch_go_back = go_back;
+    ctx->launch_aligned = false;
+    
+    /// The robot may have approached at a bearing.
+    compass_set_target(0);
+    
+    /// Low Speed Mode for turning.
+    wheel_set_speed(LOW);
+    
+    /// Prepare to move backwards.
+    if (go_back) {
+        wheel_set_direction(BOTH, BACKWARD);
+        
+    /// Turn the shortest way to the start heading.
+    } else {
+        turn_in_place(compass_target_turn());
+    }
+    
+    /// Let go of the robot.
+    wheel_toggle_brake(BOTH, OFF);
+    
+    next_state(ctx, TURN_TO_LAUNCH);
+}
+
+/************************************************************************/
+/* Help function to back away from a wall ahead and turn to the most    */
+/* open side.                                                           */
+/************************************************************************/
+static void start_turn_for_wall(state_context_t *ctx)
+{
+    /// Resets the counter for trigger signals close to a wall.
+    ctx->back_away_counter = 0;
+    
+    /// Low Speed Mode for turning.
+    wheel_set_speed(LOW);
+    
+    /// The left side is the most open.
+    if (wall_turn_side() == LEFT) {
+        /// Turn left.
+        ctx->turn_left = true;
+    }
+    
+    /// Prepare to move backwards.
+    wheel_set_direction(BOTH, BACKWARD);
+    
+    /// Let go of the robot.
+    wheel_toggle_brake(BOTH, OFF);
+    
+    kpi_event(KPI_WALL_TURNS);
+    
+    next_state(ctx, TURN_FOR_WALL);
+}
+
+/************************************************************************/
+/* Help function to turn in place, clockwise (right) for @param turn > 0*/
+/* and counterclockwise (left) otherwise.                               */
+/************************************************************************/
+static void turn_in_place(int8_t turn)
+{
+    /// Turn right.
+    if (turn > 0) {
+        wheel_set_direction(LEFT, FORWARD);
+        wheel_set_direction(RIGHT, BACKWARD);
+        
+    /// Turn left.
+    } else {
+        wheel_set_direction(LEFT, BACKWARD);
+        wheel_set_direction(RIGHT, FORWARD);
+    }
+}
+
+/************************************************************************/
+/* Help function that @returns the driving speed (cm/s) in the default  */
+/* state. Slow near obstacles or with a ball maybe in sight (@param     */
+/* ball_in_sight), faster with the nearest obstacle farther away.       */
+/************************************************************************/
+static uint8_t cruise_speed(bool ball_in_sight)
+{
+    uint8_t nearest = scan_nearest_distance();
+    
+    /// Nothing seen yet or a ball to look at.
+    if ((nearest == SCAN_UNKNOWN) || ball_in_sight) {
+        return CRUISE_SPEED_MIN;
+    }
+    
+    nearest = constrain(nearest, (uint8_t) CRUISE_NEAR_DISTANCE, (uint8_t) CRUISE_FREE_DISTANCE);
+    
+    uint8_t speed = (uint8_t) map(nearest, CRUISE_NEAR_DISTANCE, CRUISE_FREE_DISTANCE, CRUISE_SPEED_MIN, CRUISE_SPEED_MAX);
+    
+    /// Rounds down to a whole speed step.
+    return speed - ((speed - CRUISE_SPEED_MIN) % CRUISE_SPEED_STEP);
+}
+
+/************************************************************************/
+/* Help function that @returns the side (LEFT or RIGHT) to turn to for  */
+/* wall. The sweep decides, or the remembered walls when it can't.      */
+/************************************************************************/
+static uint8_t wall_turn_side(void)
+{
+    if (scan_clearance(LEFT) == scan_clearance(RIGHT)) {
+        uint8_t left  = grid_clearance(-90, GRID_SIDE_DISTANCE);
+        uint8_t right = grid_clearance(90, GRID_SIDE_DISTANCE);
+        
+        if (left != right) {
+            return (left > right) ? LEFT : RIGHT;
+        }
+    }
+    
+    return scan_open_side();
+}
+
+/************************************************************************/
+/* Help function to drive the robot of a context (@param ctx) while a   */
+/* ball is picked up and loaded. It holds the robot until the catch is  */
+/* confirmed (BUCKET_IN), then creeps forward unless a wall is          */
+/* predicted ahead. The launch and startup states hold the robot        */
+/* themselves.                                                          */
+/************************************************************************/
+static void pickup_drive(state_context_t *ctx)
+{
+    if (ctx->launching || (ctx->state < _DEFAULT)) {
+        return;
+    }
+    
+    /// The robot can't stop in front of a wall anymore - stop for the rest of the pickup.
+    if (contact_predicted()) {
+        ctx->pickup_stopped = true;
+    }
+    
+    /// Stop the robot.
+    if (ctx->pickup_stopped || (ctx->state == BUCKET_IN) || (PICKUP_SPEED == 0)) {
+        wheel_toggle_brake(BOTH, ON);
+        
+    /// Keep creeping forward.
+    } else {
+        wheel_set_target(BOTH, PICKUP_SPEED);
+        wheel_toggle_brake(BOTH, OFF);
+    }
 }
\ No newline at end of file
@@ -5,24 +5,101 @@
 #ifndef STATE_H
 #define STATE_H
 
+#include "robot.h"
+#include "timer.h"
+
+/// Memory of the state machine. The handlers keep everything they need
+/// between ticks here, so a run can be reset (state_reset()).
+typedef struct {
+    /// Current state of the robot.
+    int8_t state;
+    
+    /// Timer for the time spent in the current state, and the number of times
+    /// each state (STATE_INDEX()) ran out of its time budget.
+    tick_timer_t dwell_timer;
+    uint8_t overruns[STATE_COUNT];
+    
+    /// Variables saying if the robot is on its way to launch the held balls, or
+    /// launching them back-to-back.
+    bool going_to_launch;
+    bool launching;
+    
+    /// Variable saying what way to turn for wall.
+    bool turn_left;
+    
+    /// Variable saying if the robot is trying to find the mid wall.
+    bool searching_for_mid_wall;
+    
+    /// Variable saying if a compass calibration is requested.
+    bool calibration_requested;
+    
+    /// Timer for the angle steps of the moving servo.
+    tick_timer_t servo_step_timer;
+    
+    /// Compass calibration: phase, timer, quadrants (bit 0-3) seen after the
+    /// calibration, and heading and offset from the start heading before the
+    /// calibration.
+    uint8_t calibration_phase;
+    tick_timer_t calibration_timer;
+    uint8_t calibration_quadrants;
+    int16_t calibration_heading;
+    int16_t calibration_offset;
+    
+    /// Default state: timer for search for mid wall delay and counter for bucket
+    /// trigger signals when close to a wall.
+    tick_timer_t mid_wall_timer;
+    uint8_t back_away_counter;
+    
+    /// Pickup: variable saying if the robot stopped for a wall during the pickup.
+    bool pickup_stopped;
+    
+    /// Lifting arm up: timer for the delay at max angle.
+    tick_timer_t arm_delay_timer;
+    
+    /// Turn to mid wall: move backwards first or not, timers for moving backwards
+    /// and time out.
+    bool mid_wall_go_back;
+    tick_timer_t mid_wall_go_back_timer;
+    tick_timer_t mid_wall_time_out_timer;
+    
+    /// Turn for wall: move backwards or not, timers for turning and moving backwards.
+    bool wall_go_back;
+    tick_timer_t wall_turn_timer;
+    tick_timer_t wall_go_back_timer;
+    
+    /// Turn to launch: move backwards or not, turned to the start heading or not,
+    /// timers for turning, moving backwards and turning to the start heading.
+    bool launch_go_back;
+    bool launch_aligned;
+    tick_timer_t launch_turn_timer;
+    tick_timer_t launch_go_back_timer;
+    tick_timer_t launch_align_timer;
+} state_context_t;
+
 /************************************************************************/
-/* Declaration of functions used in sensor.cpp (needed elsewhere).      */
+/* Declaration of functions used in state.cpp (needed elsewhere).       */
 /************************************************************************/
 void state_init(void);
-void compass_calibration_state(void);
-void default_state(void);
-void bucket_in(void);
-void bucket_out(void);
-void lifting_arm_up(void);
-void lifting_arm_down(void);
-void turn_to_mid_wall(void);
-void turn_for_wall(void);
-void turn_to_launch(void);
-void catapult_arm_up(void);
-void catapult_arm_down(void);
-void catapult_lock(void);
-void catapult_unlock(void);
+void state_reset(state_context_t *);
+state_context_t *state_context(void);
+void state_budget_tick(state_context_t *);
+uint8_t state_overruns(int8_t);
+void compass_calibration_state(state_context_t *);
+void default_state(state_context_t *);
+void bucket_in(state_context_t *);
+void bucket_out(state_context_t *);
+void lifting_arm_up(state_context_t *);
+void lifting_arm_down(state_context_t *);
+void turn_to_mid_wall(state_context_t *);
+void turn_for_wall(state_context_t *);
+void turn_to_launch(state_context_t *);
+void catapult_arm_up(state_context_t *);
+void catapult_arm_down(state_context_t *);
+void catapult_lock(state_context_t *);
+void catapult_unlock(state_context_t *);
+void request_compass_calibration(void);
 bool going_for_mid_wall(void);
 int8_t current_state(void);
+void state_print_name(int8_t);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+/************************************************************************/
+/* sweep.cpp - The .cpp file for the adaptive top sensor sweep.         */
+/*                                                                      */
+/* Narrows and speeds up the sweep around the heading when driving fast */
+/* or when something is close, and widens it when the area is clear.    */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "sweep.h"
+#include "config.h"
+#include "robot.h"
+#include "scan.h"
+#include "servo.h"
+#include "state.h"
+#include "timer.h"
+#include "wheel.h"
+#include <util/atomic.h>
+
+/// Wide field of view (the full servo range).
+#define SWEEP_WIDE_MIN  15
+#define SWEEP_WIDE_MAX  135
+
+/// Narrow field of view around the heading.
+#define SWEEP_NARROW_MIN  45
+#define SWEEP_NARROW_MAX  105
+
+/// Width in degrees of the narrow field of view.
+#define SWEEP_NARROW_WIDTH  (SWEEP_NARROW_MAX - SWEEP_NARROW_MIN)
+
+/// Time for the servo to settle after a 30 degree step (ms).
+#define SWEEP_SETTLE_TIME  90
+
+/// Memory of the sweep for a run.
+typedef struct {
+    /// Current time between top sensor pings (ticks).
+    volatile uint16_t period_ticks;
+    
+    /// Time (ms) of the latest servo move.
+    unsigned long move_time;
+} sweep_context_t;
+
+/// The sweep of the robot.
+static RUN_LOCAL sweep_context_t sweep_context;
+
+/************************************************************************/
+/* Clears the sweep to the start of a run (wide).                       */
+/************************************************************************/
+void sweep_clear(void)
+{
+    memset(&sweep_context, 0, sizeof(sweep_context_t));
+    
+    sweep_context.period_ticks = MS_TO_TICKS(SWEEP_WIDE_PERIOD);
+}
+
+/************************************************************************/
+/* Moves the top sensor servo to the next position of the sweep.        */
+/* Called right after a ping is completed.                              */
+/************************************************************************/
+void sweep_step(void)
+{
+    uint8_t nearest = scan_nearest_distance();
+    
+    /// Something is close - keep looking ahead.
+    bool narrow = (nearest != SCAN_UNKNOWN) && (nearest < SWEEP_NEAR_DISTANCE);
+    
+    /// Driving fast - keep looking ahead unless the area ahead is clear.
+    if ((wheel_speed() > NAV_SPEED_LOW) && (scan_free_sector_width(SWEEP_CLEAR_DISTANCE) <= SWEEP_NARROW_WIDTH)) {
+        narrow = true;
+    }
+    
+    /// Rotates the top sensor servo to mid position (also while driving during a pickup).
+    if (going_for_mid_wall() || (current_state() != _DEFAULT)) {
+        top_sensor_servo_mid();
+        
+    /// Rotates the top sensor servo within the narrow field of view.
+    } else if (narrow) {
+        top_sensor_servo_rotate(SWEEP_NARROW_MIN, SWEEP_NARROW_MAX);
+        
+    /// Rotates the top sensor servo within the wide field of view.
+    } else {
+        top_sensor_servo_rotate(SWEEP_WIDE_MIN, SWEEP_WIDE_MAX);
+    }
+    
+    sweep_context.move_time = millis();
+    
+    ATOMIC_BLOCK(ATOMIC_FORCEON) {
+        sweep_context.period_ticks = narrow ? MS_TO_TICKS(SWEEP_NARROW_PERIOD) : MS_TO_TICKS(SWEEP_WIDE_PERIOD);
+    }
+}
+
+/************************************************************************/
+/* @returns whether the top sensor servo has stopped moving or not.     */
+/************************************************************************/
+bool sweep_settled(void)
+{
+    return ((millis() - sweep_context.move_time) >= SWEEP_SETTLE_TIME) ? true : false;
+}
+
+/************************************************************************/
+/* @returns the time between top sensor pings (ticks).                  */
+/************************************************************************/
+uint16_t sweep_period(void)
+{
+    return sweep_context.period_ticks;
+}
\ No newline at end of file
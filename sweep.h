@@ -0,0 +1,16 @@
+/************************************************************************/
+/* sweep.h - The .h file for the adaptive top sensor sweep.             */
+/************************************************************************/
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+/************************************************************************/
+/* Declaration of functions used in sweep.cpp (needed elsewhere).       */
+/************************************************************************/
+void sweep_clear(void);
+void sweep_step(void);
+bool sweep_settled(void);
+uint16_t sweep_period(void);
+
+#endif
\ No newline at end of file
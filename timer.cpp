@@ -4,6 +4,67 @@
 
 #include "Arduino.h"
 #include "timer.h"
+#include "robot.h"
+#include <avr/wdt.h>
+#include <util/atomic.h>
+
+/// Timer4 counts per ms with the 64 prescaler.
+#define TIMER4_COUNTS_PER_MS  (F_CPU / 64 / 1000)
+
+#if (TICK_PERIOD_MS < 1) || ((TIMER4_COUNTS_PER_MS * TICK_PERIOD_MS) > 65536UL)
+#error "TICK_PERIOD_MS must be between 1 and 262 ms"
+#endif
+
+/// Backlog of ticks the main loop may catch up with at once (ms).
+/// Older ticks are dropped and counted as missed.
+#define TIMER_CATCH_UP_TIME  50
+
+/// Time the watchdog gives blocking I/O before it resets the robot.
+/// An I2C transaction with the compass takes about 1 ms.
+#define TIMER_WATCHDOG_TIMEOUT  WDTO_120MS
+
+/// Memory of the ticks for a run.
+typedef struct {
+    /// Ticks not yet run by the main loop.
+    volatile uint16_t pending_ticks;
+    
+    /// Number of dropped ticks.
+    volatile uint16_t missed;
+    
+    /// Number of ticks run since startup.
+    uint32_t run_ticks;
+} timer_context_t;
+
+/// The ticks of the robot.
+static RUN_LOCAL timer_context_t timer_context;
+
+/// Variables holding the reset cause (MCUSR) and the number of watchdog resets since power-on.
+/// Not cleared at startup, so the count survives a watchdog reset.
+static uint8_t timer_reset_flags __attribute__((section(".noinit")));
+static uint8_t timer_watchdog_count __attribute__((section(".noinit")));
+
+/************************************************************************/
+/* Runs before the sketch starts. Saves the reset cause and stops the   */
+/* watchdog, which stays enabled after a watchdog reset.                */
+/************************************************************************/
+void timer_boot(void) __attribute__((naked, used, section(".init3")));
+
+void timer_boot(void)
+{
+    timer_reset_flags = MCUSR;
+    MCUSR = 0;
+    wdt_disable();
+}
+
+/************************************************************************/
+/* Clears the ticks to the start of a run.                              */
+/************************************************************************/
+void timer_clear(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        memset(&timer_context, 0, sizeof(timer_context_t));
+    }
+}
 
 /************************************************************************/
 /* Initialization of Timer4.                                            */
@@ -13,9 +74,150 @@ void timer4_init(void)
   TIMSK4 = (1 << OCIE4B);  // Interrupt enable
   TCCR4A = 0;
   TCCR4B = (1 << WGM42);   // CTC mode
-  OCR4A  = 624;            // Total timer ticks
+  OCR4A  = (TIMER4_COUNTS_PER_MS * TICK_PERIOD_MS) - 1;  // Total timer ticks
+
+  TCCR4B |= (1 << CS41) | (1 << CS40);  // 64 prescaler
+}
+
+/************************************************************************/
+/* Counts and reports a watchdog reset. Called once at startup.         */
+/************************************************************************/
+void timer_watchdog_init(void)
+{
+    /// The count holds garbage after power-on.
+    if (timer_reset_flags & ((1 << PORF) | (1 << BORF))) {
+        timer_watchdog_count = 0;
+    }
+    
+    if (timer_reset_flags & (1 << WDRF)) {
+        if (timer_watchdog_count < UINT8_MAX) {
+            timer_watchdog_count++;
+        }
+        
+        Serial.println(F("Watchdog reset"));
+    }
+}
+
+/************************************************************************/
+/* Arms the watchdog before blocking I/O.                               */
+/************************************************************************/
+void timer_watchdog_arm(void)
+{
+    wdt_enable(TIMER_WATCHDOG_TIMEOUT);
+}
+
+/************************************************************************/
+/* Disarms the watchdog after blocking I/O.                             */
+/************************************************************************/
+void timer_watchdog_disarm(void)
+{
+    wdt_disable();
+}
+
+/************************************************************************/
+/* @returns the number of watchdog resets since power-on.               */
+/************************************************************************/
+uint8_t timer_watchdog_resets(void)
+{
+    return timer_watchdog_count;
+}
+
+/************************************************************************/
+/* @returns the number of ticks for the main loop to run now. Ticks     */
+/* beyond the catch-up limit are dropped and counted as missed.         */
+/************************************************************************/
+uint16_t timer_take_ticks(void)
+{
+    uint16_t ticks;
+    
+    ATOMIC_BLOCK(ATOMIC_FORCEON) {
+        ticks = timer_context.pending_ticks;
+        timer_context.pending_ticks = 0;
+    }
+    
+    if (ticks > MS_TO_TICKS(TIMER_CATCH_UP_TIME)) {
+        timer_context.missed += ticks - MS_TO_TICKS(TIMER_CATCH_UP_TIME);
+        ticks = MS_TO_TICKS(TIMER_CATCH_UP_TIME);
+    }
+    
+    return ticks;
+}
+
+/************************************************************************/
+/* Takes one posted tick, without the catch-up limit.                   */
+/* @returns whether there was one or not.                               */
+/************************************************************************/
+bool timer_take_tick(void)
+{
+    bool taken = false;
+    
+    ATOMIC_BLOCK(ATOMIC_FORCEON) {
+        if (timer_context.pending_ticks > 0) {
+            timer_context.pending_ticks--;
+            taken = true;
+        }
+    }
+    
+    return taken;
+}
+
+/************************************************************************/
+/* Advances the run time one tick. Called from control_tick().          */
+/************************************************************************/
+void timer_tick(void)
+{
+    timer_context.run_ticks++;
+}
 
-  TCCR4B |= (1 << CS42);   // 256 prescaler
+/************************************************************************/
+/* @returns the number of ticks run since startup. Dropped ticks are    */
+/* not counted.                                                         */
+/************************************************************************/
+uint32_t timer_now(void)
+{
+    return timer_context.run_ticks;
+}
+
+/************************************************************************/
+/* @returns the number of ticks dropped since startup.                  */
+/************************************************************************/
+uint16_t timer_missed_ticks(void)
+{
+    return timer_context.missed;
+}
+
+/************************************************************************/
+/* Advances a timer (@param timer) one tick. @returns true and restarts */
+/* the timer when it has counted @param ticks.                          */
+/************************************************************************/
+bool timer_expired(tick_timer_t *timer, uint16_t ticks)
+{
+    timer->ticks++;
+    
+    if (timer->ticks >= ticks) {
+        timer->ticks = 0;
+        
+        return true;
+    }
+    
+    return false;
+}
+
+/************************************************************************/
+/* @returns whether a timer (@param timer) has counted more than        */
+/* @param ticks or not, without advancing it.                           */
+/************************************************************************/
+bool timer_after(const tick_timer_t *timer, uint16_t ticks)
+{
+    return (timer->ticks > ticks) ? true : false;
+}
+
+/************************************************************************/
+/* Restarts a timer (@param timer).                                     */
+/************************************************************************/
+void timer_reset(tick_timer_t *timer)
+{
+    timer->ticks = 0;
 }
 
 /************************************************************************/
@@ -23,5 +225,8 @@ void timer4_init(void)
 /************************************************************************/
 ISR(TIMER4_COMPB_vect)
 {
-    timer4_isr();
+    /// Posts a tick for the main loop.
+    if (timer_context.pending_ticks < UINT16_MAX) {
+        timer_context.pending_ticks++;
+    }
 }
\ No newline at end of file
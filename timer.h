@@ -1,14 +1,50 @@
 /************************************************************************/
 /* timer.h - The .h file for using timers.                              */
+/*                                                                      */
+/* Timer4 gives the tick of the state machine. The ISR only counts the  */
+/* ticks, they are run by the main loop (see timer_take_ticks()).       */
+/* Durations are given in ms and converted to ticks at compile time,    */
+/* so the tick period (TICK_PERIOD_MS in config.h) can change without   */
+/* retuning them. The state logic keeps time in ticks run (timer_now()) */
+/* and never reads millis(), so a replay of the inputs on the host (see */
+/* host/replay.cpp) gives the same run.                                 */
+/*                                                                      */
+/* The hardware watchdog is armed around blocking I/O only, so a hung   */
+/* bus resets the robot instead of stopping it for the whole match.     */
 /************************************************************************/
 
 #ifndef TIMER_H
 #define TIMER_H
 
+#include "config.h"
+
+/// Number of ticks of a duration in ms (@param ms), rounded up.
+#define MS_TO_TICKS(ms)  ((uint16_t) (((ms) + TICK_PERIOD_MS - 1) / TICK_PERIOD_MS))
+
+/// Duration in ms of a number of ticks (@param ticks).
+#define TICKS_TO_MS(ticks)  ((uint32_t) (ticks) * TICK_PERIOD_MS)
+
+/// Timer counting the ticks of a state handler. Must be static, global or in the state context.
+typedef struct {
+    uint16_t ticks;
+} tick_timer_t;
+
 /************************************************************************/
 /* Declaration of functions used in timer.cpp (needed elsewhere).       */
 /************************************************************************/
+void timer_clear(void);
 void timer4_init(void);
-extern void timer4_isr(void);
+void timer_watchdog_init(void);
+void timer_watchdog_arm(void);
+void timer_watchdog_disarm(void);
+uint8_t timer_watchdog_resets(void);
+uint16_t timer_take_ticks(void);
+bool timer_take_tick(void);
+void timer_tick(void);
+uint32_t timer_now(void);
+uint16_t timer_missed_ticks(void);
+bool timer_expired(tick_timer_t *, uint16_t);
+bool timer_after(const tick_timer_t *, uint16_t);
+void timer_reset(tick_timer_t *);
 
 #endif
\ No newline at end of file
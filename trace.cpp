@@ -0,0 +1,156 @@
+/************************************************************************/
+/* trace.cpp - The .cpp file for the timeline trace export.             */
+/*                                                                      */
+/* Converts the flight recorder into Chrome trace-event JSON, so a run  */
+/* can be opened as a timeline in chrome://tracing or Perfetto.         */
+/************************************************************************/
+
+#include "Arduino.h"
+#include "trace.h"
+#include "config.h"
+#include "recorder.h"
+#include "robot.h"
+#include "state.h"
+
+/// Length of one recorder tick in microseconds.
+#define TRACE_TICK_US  (TICK_PERIOD_MS * 1000UL)
+
+/// Timeline rows (thread ids) of the trace.
+#define TRACE_TID_STATE   1
+#define TRACE_TID_SENSOR  2
+#define TRACE_TID_WHEEL   3
+
+/// Pre-declaration of help function.
+static void trace_event(const __FlashStringHelper *, char, unsigned long, uint8_t);
+
+/// Variable saying if the next event is the first one of the trace.
+static bool trace_first = true;
+
+/************************************************************************/
+/* Prints the flight recorder over serial as Chrome trace-event JSON.   */
+/************************************************************************/
+void trace_dump(void)
+{
+    record_t record;
+    
+    /// Time of the current record in microseconds, from the first record on.
+    unsigned long ts = 0;
+    uint32_t last_tick = 0;
+    
+    /// Variable saying if a state is open on the timeline.
+    bool state_open = false;
+    
+    /// No new records while dumping.
+    recorder_pause(true);
+    
+    trace_first = true;
+    
+    Serial.println(F("{\"traceEvents\":["));
+    
+    for (uint16_t i = 0; i < recorder_count(); i++) {
+        recorder_read(i, &record);
+        
+        if (i != 0) {
+            ts += (record.tick - last_tick) * TRACE_TICK_US;
+        }
+        
+        last_tick = record.tick;
+        
+        switch (record.type) {
+            /// State exit and entry.
+            case RECORD_STATE :
+                if (state_open) {
+                    trace_event(F("state"), 'E', ts, TRACE_TID_STATE);
+                    Serial.print(F(",\"name\":\""));
+                    state_print_name((int8_t) record.id);
+                    Serial.print(F("\"}"));
+                }
+                
+                trace_event(F("state"), 'B', ts, TRACE_TID_STATE);
+                Serial.print(F(",\"name\":\""));
+                state_print_name((int8_t) record.value);
+                Serial.print(F("\"}"));
+                
+                state_open = true;
+                break;
+                
+            /// Sensor readings as counters.
+            case RECORD_BUCKET_SENSOR :
+                trace_event(F("sensor"), 'C', ts, TRACE_TID_SENSOR);
+                Serial.print(F(",\"name\":\"bucket_sensor\",\"args\":{\"cm\":"));
+                Serial.print(record.value);
+                Serial.print(F("}}"));
+                break;
+                
+            case RECORD_TOP_SENSOR :
+                trace_event(F("sensor"), 'C', ts, TRACE_TID_SENSOR);
+                Serial.print(F(",\"name\":\"top_sensor\",\"args\":{\"cm\":"));
+                Serial.print(record.value);
+                Serial.print(F(",\"angle\":"));
+                Serial.print(record.id);
+                Serial.print(F("}}"));
+                break;
+                
+            case RECORD_COMPASS :
+                trace_event(F("sensor"), 'C', ts, TRACE_TID_SENSOR);
+                Serial.print(F(",\"name\":\"compass\",\"args\":{\"heading\":"));
+                Serial.print(record.value);
+                Serial.print(F("}}"));
+                break;
+                
+            /// Wheel commands as instant events.
+            case RECORD_WHEEL_BRAKE :
+            case RECORD_WHEEL_DIRECTION :
+            case RECORD_WHEEL_SPEED :
+                trace_event(F("wheel"), 'i', ts, TRACE_TID_WHEEL);
+                
+                if (record.type == RECORD_WHEEL_BRAKE) {
+                    Serial.print(F(",\"name\":\"brake\""));
+                } else if (record.type == RECORD_WHEEL_DIRECTION) {
+                    Serial.print(F(",\"name\":\"direction\""));
+                } else {
+                    Serial.print(F(",\"name\":\"speed\""));
+                }
+                
+                Serial.print(F(",\"s\":\"t\",\"args\":{\"wheel\":"));
+                Serial.print(record.id);
+                Serial.print(F(",\"value\":"));
+                Serial.print(record.value);
+                Serial.print(F("}}"));
+                break;
+        }
+    }
+    
+    /// Closes the last state at the end of the trace.
+    if (state_open) {
+        trace_event(F("state"), 'E', ts, TRACE_TID_STATE);
+        Serial.print('}');
+    }
+    
+    Serial.println(F("\n]}"));
+    
+    recorder_pause(false);
+}
+
+/************************************************************************/
+/* Help function to print the common fields of an event of category     */
+/* (@param cat) and phase (@param ph) at time (@param ts) on row        */
+/* (@param tid). The caller prints the remaining fields and the '}'.    */
+/************************************************************************/
+static void trace_event(const __FlashStringHelper *cat, char ph, unsigned long ts, uint8_t tid)
+{
+    if (!trace_first) {
+        Serial.println(',');
+    }
+    
+    trace_first = false;
+    
+    Serial.print(F("{\"cat\":\""));
+    Serial.print(cat);
+    Serial.print(F("\",\"ph\":\""));
+    Serial.print(ph);
+    Serial.print(F("\",\"ts\":"));
+    Serial.print(ts);
+    Serial.print(F(",\"pid\":1,\"tid\":"));
+    Serial.print(tid);
+}
\ No newline at end of file
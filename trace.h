@@ -0,0 +1,13 @@
+/************************************************************************/
+/* trace.h - The .h file for the timeline trace export.                 */
+/************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/************************************************************************/
+/* Declaration of functions used in trace.cpp (needed elsewhere).       */
+/************************************************************************/
+void trace_dump(void);
+
+#endif
\ No newline at end of file
@@ -4,23 +4,59 @@
 
 #include "Arduino.h"
 #include "wheel.h"
+#include "compass.h"
+#include "config.h"
+#include "recorder.h"
 #include "robot.h"
+#include "timer.h"
 
 /// Arduino specific pins for using the motor shield.
+/// Both speed pins are 8 bit phase correct PWM at 490 Hz (OC2A and OC1A), so equal duty
+/// cycles give equal wheel speeds. The shield's PWM A (pin 3, OC3C) is jumpered to pin 10,
+/// Timer3 runs the servos at 50 Hz.
 #define BRAKE_A_PIN  9
 #define BRAKE_B_PIN  8
 #define DIR_A_PIN    12
 #define DIR_B_PIN    13
-#define SPEED_A_PIN  3
+#define SPEED_A_PIN  10
 #define SPEED_B_PIN  11
 
-/// Wheel speed in High Speed Mode.
-#define WHEEL_SPEED_RIGHT_HIGH  120
-#define WHEEL_SPEED_LEFT_HIGH   120
+/// Memory of the wheels for a run.
+typedef struct {
+    /// Current brake status, direction and target speed (cm/s) of the wheels (RIGHT, LEFT).
+    uint8_t brake_status[2];
+    uint8_t direction_status[2];
+    uint8_t speed_target[2];
+    
+    /// Learned trim (PWM steps added to the right wheel and taken from the left).
+    int8_t trim;
+    
+    /// Trim drift measurement: timer, heading at the start (degrees) and running or not.
+    tick_timer_t trim_timer;
+    int16_t trim_heading;
+    bool trim_measuring;
+} wheel_context_t;
+
+/// The wheels of the robot.
+static RUN_LOCAL wheel_context_t wheel_context;
 
-/// Wheel speed in Low Speed Mode.
-#define WHEEL_SPEED_RIGHT_LOW   100
-#define WHEEL_SPEED_LEFT_LOW    100
+/// Pre-declaration of help functions.
+static void wheel_store(uint8_t, uint8_t *, uint8_t, uint8_t);
+static void wheel_apply(uint8_t);
+
+/************************************************************************/
+/* Clears the wheels to the start of a run (braked, forward, no trim).  */
+/************************************************************************/
+void wheel_clear(void)
+{
+    memset(&wheel_context, 0, sizeof(wheel_context_t));
+    
+    for (uint8_t wh = RIGHT; wh <= LEFT; wh++) {
+        wheel_context.brake_status[wh]     = ON;
+        wheel_context.direction_status[wh] = FORWARD;
+        wheel_context.speed_target[wh]     = NAV_SPEED_HIGH;
+    }
+}
 
 /************************************************************************/
 /* Initialization of the wheel control.                                 */
@@ -32,7 +68,8 @@ void wheel_init(void)
     pinMode(BRAKE_A_PIN, OUTPUT);     // Brake pin as output
     digitalWrite(DIR_A_PIN, HIGH);     // Set forward direction 
     digitalWrite(BRAKE_A_PIN, HIGH);  // Engage brake
-    analogWrite(SPEED_A_PIN, WHEEL_SPEED_RIGHT_HIGH); // Set wheel speed
+    pinMode(SPEED_A_PIN, OUTPUT);     // Speed pin as output
+    wheel_apply(RIGHT);               // Set wheel speed
     
 
     /* Channel B -- Left Wheel */
@@ -40,7 +77,7 @@ void wheel_init(void)
     pinMode(BRAKE_B_PIN, OUTPUT);     // Brake pin as output
     digitalWrite(DIR_B_PIN, HIGH);    // Set forward direction 
     digitalWrite(BRAKE_B_PIN, HIGH);  // Engage brake
-    analogWrite(SPEED_B_PIN, WHEEL_SPEED_LEFT_HIGH); // Set wheel speed
+    wheel_apply(LEFT);                // Set wheel speed
 }
 
 /************************************************************************/
@@ -48,6 +85,8 @@ void wheel_init(void)
 /************************************************************************/
 void wheel_toggle_brake(uint8_t wh, uint8_t val)
 {
+    wheel_store(RECORD_WHEEL_BRAKE, wheel_context.brake_status, wh, val);
+    
     switch(wh) {
         case RIGHT :
             digitalWrite(BRAKE_A_PIN, val);
@@ -66,6 +105,8 @@ void wheel_toggle_brake(uint8_t wh, uint8_t val)
 /************************************************************************/
 void wheel_set_direction(uint8_t wh, uint8_t val)
 {
+    wheel_store(RECORD_WHEEL_DIRECTION, wheel_context.direction_status, wh, val);
+    
     switch(wh) {
         case RIGHT :
             digitalWrite(DIR_A_PIN, val);
@@ -79,18 +120,175 @@ void wheel_set_direction(uint8_t wh, uint8_t val)
     }
 }
 
+/************************************************************************/
+/* Set the target speed (@param speed, cm/s) of one or both wheels      */
+/* (@param wh).                                                         */
+/************************************************************************/
+void wheel_set_target(uint8_t wh, uint8_t speed)
+{
+    /// The PWM is not extrapolated beyond the highest calibrated speed.
+    speed = min(speed, (uint8_t) NAV_SPEED_HIGH);
+    
+    for (uint8_t i = RIGHT; i <= LEFT; i++) {
+        if (((wh == i) || (wh == BOTH)) && (wheel_context.speed_target[i] != speed)) {
+            wheel_context.speed_target[i] = speed;
+            
+            recorder_log(RECORD_WHEEL_SPEED, i, speed);
+            
+            wheel_apply(i);
+        }
+    }
+}
+
 /************************************************************************/
 /* Set the motors in High- or Low Speed Mode (@param mode).             */
 /************************************************************************/
 void wheel_set_speed(uint8_t mode)
 {
-    /// High Speed Mode
-    if (mode) {
-        analogWrite(SPEED_A_PIN, WHEEL_SPEED_RIGHT_HIGH);
-        analogWrite(SPEED_B_PIN, WHEEL_SPEED_LEFT_HIGH);
-    /// Low Speed Mode
+    wheel_set_target(BOTH, mode ? NAV_SPEED_HIGH : NAV_SPEED_LOW);
+}
+
+/************************************************************************/
+/* @returns the target speed of the robot (cm/s).                       */
+/************************************************************************/
+uint8_t wheel_speed(void)
+{
+    return (uint8_t) ((wheel_context.speed_target[RIGHT] + wheel_context.speed_target[LEFT]) / 2);
+}
+
+/************************************************************************/
+/* Learns the trim from the heading drift while driving straight        */
+/* forward. Called from control_tick().                                 */
+/************************************************************************/
+void wheel_tick(void)
+{
+    /// Only a straight drive forward with the same target on both wheels shows the drift.
+    if ((wheel_drive_direction() <= 0) || (wheel_context.speed_target[RIGHT] != wheel_context.speed_target[LEFT]) || compass_calibrating()) {
+        wheel_context.trim_measuring = false;
+        return;
+    }
+    
+    /// Starts a measurement.
+    if (!wheel_context.trim_measuring) {
+        timer_reset(&wheel_context.trim_timer);
+        wheel_context.trim_heading = compass_offset();
+        wheel_context.trim_measuring = true;
+        return;
+    }
+    
+    if (!timer_expired(&wheel_context.trim_timer, MS_TO_TICKS(WHEEL_TRIM_PERIOD))) {
+        return;
+    }
+    
+    int16_t heading = compass_offset();
+    int16_t drift = heading - wheel_context.trim_heading;
+    
+    if (drift > 180) {
+        drift -= 360;
+    } else if (drift < -180) {
+        drift += 360;
+    }
+    
+    wheel_context.trim_heading = heading;
+    
+    /// Drifting clockwise (right) - the right wheel is too slow.
+    if ((drift > WHEEL_TRIM_DEADBAND) && (wheel_context.trim < WHEEL_TRIM_MAX)) {
+        wheel_context.trim++;
+    
+    /// Drifting counterclockwise (left) - the left wheel is too slow.
+    } else if ((drift < -WHEEL_TRIM_DEADBAND) && (wheel_context.trim > -WHEEL_TRIM_MAX)) {
+        wheel_context.trim--;
+        
+    /// Driving straight.
     } else {
-        analogWrite(SPEED_A_PIN, WHEEL_SPEED_RIGHT_LOW);
-        analogWrite(SPEED_B_PIN, WHEEL_SPEED_LEFT_LOW); 
+        return;
     }
+    
+    wheel_apply(RIGHT);
+    wheel_apply(LEFT);
+}
+
+/************************************************************************/
+/* @returns the learned trim (PWM steps, right wheel faster > 0).       */
+/************************************************************************/
+int8_t wheel_trim(void)
+{
+    return wheel_context.trim;
+}
+
+/************************************************************************/
+/* @returns the commanded turn of the robot: 1 for clockwise (right),   */
+/* -1 for counterclockwise (left) and 0 for straight or standing still. */
+/************************************************************************/
+int8_t wheel_turn_direction(void)
+{
+    int8_t turn = 0;
+    
+    /// A released wheel pushes its side of the robot forward or backward.
+    for (uint8_t i = RIGHT; i <= LEFT; i++) {
+        if (wheel_context.brake_status[i] == OFF) {
+            int8_t push = (wheel_context.direction_status[i] == FORWARD) ? 1 : -1;
+            
+            turn += (i == LEFT) ? push : -push;
+        }
+    }
+    
+    return (turn > 0) ? 1 : ((turn < 0) ? -1 : 0);
+}
+
+/************************************************************************/
+/* @returns the commanded travel of the robot: 1 for forward, -1 for    */
+/* backward and 0 for turning or standing still.                        */
+/************************************************************************/
+int8_t wheel_drive_direction(void)
+{
+    if ((wheel_context.brake_status[RIGHT] == ON) || (wheel_context.brake_status[LEFT] == ON) || 
+        (wheel_context.direction_status[RIGHT] != wheel_context.direction_status[LEFT])) {
+        return 0;
+    }
+    
+    return (wheel_context.direction_status[RIGHT] == FORWARD) ? 1 : -1;
+}
+
+/************************************************************************/
+/* @returns whether both wheels are braked or not.                      */
+/************************************************************************/
+bool wheel_braked(void)
+{
+    return ((wheel_context.brake_status[RIGHT] == ON) && (wheel_context.brake_status[LEFT] == ON)) ? true : false;
+}
+
+/************************************************************************/
+/* Help function to store the status (@param val) of one or both wheels */
+/* (@param wh) in @param status, and record the changes of @param type. */
+/************************************************************************/
+static void wheel_store(uint8_t type, uint8_t *status, uint8_t wh, uint8_t val)
+{
+    for (uint8_t i = RIGHT; i <= LEFT; i++) {
+        if (((wh == i) || (wh == BOTH)) && (status[i] != val)) {
+            status[i] = val;
+            
+            recorder_log(type, i, val);
+        }
+    }
+}
+
+/************************************************************************/
+/* Help function to set the PWM duty cycle of one wheel (@param wh)     */
+/* from its target speed and the trim. The speed is interpolated        */
+/* between the PWM values of Low- and High Speed Mode.                  */
+/************************************************************************/
+static void wheel_apply(uint8_t wh)
+{
+    int16_t low  = (wh == RIGHT) ? WHEEL_SPEED_RIGHT_LOW  : WHEEL_SPEED_LEFT_LOW;
+    int16_t high = (wh == RIGHT) ? WHEEL_SPEED_RIGHT_HIGH : WHEEL_SPEED_LEFT_HIGH;
+    int16_t pwm  = 0;
+    
+    if (wheel_context.speed_target[wh] != 0) {
+        pwm = low + ((int16_t) wheel_context.speed_target[wh] - NAV_SPEED_LOW) * (high - low) / (NAV_SPEED_HIGH - NAV_SPEED_LOW);
+        pwm += (wh == RIGHT) ? wheel_context.trim : -wheel_context.trim;
+        pwm = constrain(pwm, (int16_t) 0, (int16_t) 255);
+    }
+    
+    analogWrite((wh == RIGHT) ? SPEED_A_PIN : SPEED_B_PIN, (uint8_t) pwm);
 }
\ No newline at end of file
@@ -8,9 +8,17 @@
 /************************************************************************/
 /* Declaration of functions used in wheel.cpp (needed elsewhere).       */
 /************************************************************************/
+void wheel_clear(void);
 void wheel_init(void);
 void wheel_toggle_brake(uint8_t, uint8_t);
 void wheel_set_direction(uint8_t, uint8_t);
+void wheel_set_target(uint8_t, uint8_t);
 void wheel_set_speed(uint8_t);
+uint8_t wheel_speed(void);
+void wheel_tick(void);
+int8_t wheel_trim(void);
+int8_t wheel_turn_direction(void);
+int8_t wheel_drive_direction(void);
+bool wheel_braked(void);
 
 #endif
\ No newline at end of file